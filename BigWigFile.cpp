@@ -0,0 +1,491 @@
+#include <algorithm>
+#include "TxtFile.h"
+#include "BigWigFile.h"
+
+#define BW_MAGIC		0x888FFC26	// bigWig signature
+#define BPT_MAGIC		0x78CA8C91	// chromosomes B+ tree signature
+#define CIR_MAGIC		0x2468ACE0	// R-tree index signature
+#define BW_VERSION		4
+#define BW_HEAD_SIZE	64			// length of header
+#define ZOOM_HEAD_SIZE	24			// length of zoom level header
+#define MAX_ZOOM_CNT	10			// maximum number of zoom levels
+#define ZOOM_INCR		4			// ratio of reductions of adjacent zoom levels
+#define SUMMARY_OFFSET	(BW_HEAD_SIZE + MAX_ZOOM_CNT * ZOOM_HEAD_SIZE)	// offset of total summary
+#define DATA_OFFSET		(SUMMARY_OFFSET + 40)	// offset of data: number of sections and sections
+#define BPT_HEAD_SIZE	32			// length of B+ tree header
+#define CIR_HEAD_SIZE	48			// length of R-tree header
+#define NODE_HEAD_SIZE	4			// length of tree node header
+#define CIR_LEAF_SIZE	32			// length of R-tree leaf item
+#define CIR_NODE_SIZE	24			// length of R-tree non-leaf item
+#define BLOCK_SIZE		256			// maximum number of children in tree node
+#define ITEMS_PER_SLOT	1024		// maximum number of items in data section or zoom block
+#define SECT_HEAD_SIZE	24			// length of data section header
+#define ITEM_SIZE		12			// length of bedGraph item
+#define ZOOM_ITEM_SIZE	32			// length of zoom summary
+#define BEDGRAPH_TYPE	1			// type of data section
+
+// Puts value to buffer in native byte order
+//	@dst: pointer to buffer; moved after the value
+//	@val: value
+template<typename T> inline void Put(char*& dst, T val)
+{
+	memcpy(dst, &val, sizeof(T));
+	dst += sizeof(T);
+}
+
+// Counts the nodes of tree on each level, beginning from leaves.
+// The root is the only node of the last level.
+//	@itemCnt: number of leaf items
+//	@blockSize: maximum number of children in node
+//	@nodeCnts: returned numbers of nodes
+void CountNodes(ULLONG itemCnt, UINT blockSize, vector<ULLONG>& nodeCnts)
+{
+	do {
+		itemCnt = (itemCnt + blockSize - 1) / blockSize;
+		nodeCnts.push_back(itemCnt ? itemCnt : 1);
+	} while( itemCnt > 1 );
+}
+
+// Creates new instance
+//	@fName: file name
+//	@chromSizes: name of chrom.sizes file
+BigWigFile::BigWigFile(const char* fName, const char* chromSizes) :
+	_file(NULL), _sizesName(chromSizes), _chromSize(0), _lastEnd(0),
+	_offset(0), _sectCnt(0), _itemCnt(0), _basesCnt(0), _maxBlockLen(0),
+	_zooms(NULL), _zoomCnt(0), _error(false)
+{
+	TabFile file(FS::CheckedFileName(chromSizes), TxtFile::READ, 2, 2);
+	chrlen size;
+	while( file.GetLine() ) {
+		file.UIntField(1, size);
+		_sizes[file.StrField(0)] = size;
+	}
+	if( !(_file = fopen(fName, "wb")) )		Err(Err::F_OPEN, fName).Throw();
+	_total.MinVal = _total.MaxVal = _total.SumData = _total.SumSquares = 0;
+	_items.reserve(ITEMS_PER_SLOT);
+	// reserve room for header, zoom headers, total summary and number of sections
+	_block.resize(DATA_OFFSET + sizeof(ULLONG));
+	Write(&_block[0], _block.size());
+}
+
+BigWigFile::~BigWigFile()
+{
+	Close();
+	if( _zooms ) {
+		for(BYTE i=0; i<_zoomCnt; i++)
+			fclose(_zooms[i].Tmp);
+		delete [] _zooms;
+	}
+}
+
+// Writes data to file
+void BigWigFile::Write(const void* data, size_t len)
+{
+	if( fwrite(data, 1, len, _file) != len )	_error = true;
+	_offset += len;
+}
+
+// Compresses serialized block
+//	@len: length of serialized block
+//	return: compressed block and its length in @len
+const char* BigWigFile::Compress(UINT& len)
+{
+	if( len > _maxBlockLen )	_maxBlockLen = len;
+#ifdef _NO_ZLIB
+	return &_block[0];
+#else
+	uLongf zLen = compressBound(len);
+	if( _zBlock.size() < zLen )		_zBlock.resize(zLen);
+	if( compress((Bytef*)&_zBlock[0], &zLen, (const Bytef*)&_block[0], len) != Z_OK )
+		_error = true;
+	len = UINT(zLen);
+	return &_zBlock[0];
+#endif
+}
+
+// Sets current chromosome
+//	@name: chromosome's name
+void BigWigFile::SetChrom(const string& name)
+{
+	WriteSection();
+	map<string,chrlen>::const_iterator it = _sizes.find(name);
+	if( it == _sizes.end() )
+		Err("no chromosome " + name, _sizesName).Throw();
+	if( find(_chroms.begin(), _chroms.end(), name) != _chroms.end() )
+		Err("records of chromosome " + name + " are not contiguous", "bigWig output").Throw();
+	_chroms.push_back(name);
+	_chromSize = it->second;
+	_lastEnd = 0;
+}
+
+// Adds records of current chromosome.
+// Records outside chromosome are clipped, overlapped ones are clipped by previous one.
+//	@recs: records
+//	@cnt: number of records
+void BigWigFile::Add(const TrackRecord* recs, size_t cnt)
+{
+	Item item;
+
+	for(const TrackRecord* rec = recs; rec < recs + cnt; rec++) {
+		item.Start = rec->Pos ? rec->Pos - 1 : 0;
+		item.End = item.Start + rec->Span;
+		if( item.Start < _lastEnd )		item.Start = _lastEnd;
+		if( item.End > _chromSize )		item.End = _chromSize;
+		if( item.Start >= item.End )	continue;
+		item.Val = float(rec->Val);
+		if( !_itemCnt || _total.MinVal > item.Val )		_total.MinVal = item.Val;
+		if( !_itemCnt || _total.MaxVal < item.Val )		_total.MaxVal = item.Val;
+		_total.SumData += double(item.Val) * (item.End - item.Start);
+		_total.SumSquares += double(item.Val) * item.Val * (item.End - item.Start);
+		_basesCnt += item.End - item.Start;
+		_itemCnt++;
+		_lastEnd = item.End;
+		_items.push_back(item);
+		if( _items.size() == ITEMS_PER_SLOT )	WriteSection();
+	}
+}
+
+// Writes current data section
+void BigWigFile::WriteSection()
+{
+	if( _items.empty() )	return;
+	if( !_zooms )	InitZooms();
+	const UINT chrom = UINT(_chroms.size() - 1);
+	UINT len = SECT_HEAD_SIZE + UINT(_items.size()) * ITEM_SIZE;
+	if( _block.size() < len )	_block.resize(len);
+	char* p = &_block[0];
+
+	Put(p, chrom);
+	Put(p, _items.front().Start);
+	Put(p, _items.back().End);
+	Put(p, UINT(0));				// item step
+	Put(p, UINT(0));				// item span
+	Put(p, BYTE(BEDGRAPH_TYPE));
+	Put(p, BYTE(0));				// reserved
+	Put(p, USHORT(_items.size()));
+	for(vector<Item>::const_iterator it=_items.begin(); it!=_items.end(); it++) {
+		Put(p, it->Start);
+		Put(p, it->End);
+		Put(p, it->Val);
+	}
+	const char* data = Compress(len);
+	_index.push_back(IndexItem(chrom, _items.front().Start, chrom, _items.back().End, _offset, len));
+	Write(data, len);
+	_sectCnt++;
+	// zoom blocks share serialization buffer, so they are filled after writing the section
+	for(vector<Item>::const_iterator it=_items.begin(); it!=_items.end(); it++)
+		AddZoomItem(chrom, *it);
+	_items.clear();
+}
+
+// Creates zoom levels with reductions based on the average length of items
+void BigWigFile::InitZooms()
+{
+	ULLONG len = 0;
+	for(vector<Item>::const_iterator it=_items.begin(); it!=_items.end(); it++)
+		len += it->End - it->Start;
+	_zooms = new Zoom[MAX_ZOOM_CNT];
+	// the first reduction is 10 times more than average item
+	for(ULLONG reduction = 10 * (len / _items.size());
+	_zoomCnt < MAX_ZOOM_CNT && reduction < UINT_MAX; reduction *= ZOOM_INCR) {
+		Zoom& zoom = _zooms[_zoomCnt];
+		if( !(zoom.Tmp = tmpfile()) ) {	_error = true;	break; }
+		zoom.Reduction = UINT(reduction);
+		zoom.Size = zoom.Count = 0;
+		zoom.Curr.ValidCnt = 0;
+		_zoomCnt++;
+	}
+}
+
+// Adds item to zoom summaries
+//	@chrom: chromosome's ID
+//	@item: added item
+void BigWigFile::AddZoomItem(UINT chrom, const Item& item)
+{
+	for(Zoom* zoom = _zooms; zoom < _zooms + _zoomCnt; zoom++) {
+		Summary& sum = zoom->Curr;
+		// item can be split between several summaries
+		for(chrlen start = item.Start, end; start < item.End; start = end) {
+			if( sum.ValidCnt && (sum.ChromID != chrom || start >= sum.End) )
+				PushSummary(*zoom);
+			if( !sum.ValidCnt ) {	// new summary
+				sum.ChromID = chrom;
+				sum.Start = start;
+				sum.End = _chromSize - start > zoom->Reduction ? start + zoom->Reduction : _chromSize;
+				sum.MinVal = sum.MaxVal = item.Val;
+				sum.SumData = sum.SumSquares = 0;
+			}
+			end = min(item.End, sum.End);
+			sum.ValidCnt += end - start;
+			if( sum.MinVal > item.Val )		sum.MinVal = item.Val;
+			if( sum.MaxVal < item.Val )		sum.MaxVal = item.Val;
+			sum.SumData += double(item.Val) * (end - start);
+			sum.SumSquares += double(item.Val) * item.Val * (end - start);
+		}
+	}
+}
+
+// Moves current summary to the block of zoom level
+void BigWigFile::PushSummary(Zoom& zoom)
+{
+	zoom.Block.push_back(zoom.Curr);
+	zoom.Count++;
+	zoom.Curr.ValidCnt = 0;
+	if( zoom.Block.size() == ITEMS_PER_SLOT )	WriteZoomBlock(zoom);
+}
+
+// Writes current block of zoom level to its temporary file
+void BigWigFile::WriteZoomBlock(Zoom& zoom)
+{
+	if( zoom.Block.empty() )	return;
+	UINT len = UINT(zoom.Block.size()) * ZOOM_ITEM_SIZE;
+	if( _block.size() < len )	_block.resize(len);
+	char* p = &_block[0];
+
+	for(vector<Summary>::const_iterator it=zoom.Block.begin(); it!=zoom.Block.end(); it++) {
+		Put(p, it->ChromID);
+		Put(p, it->Start);
+		Put(p, it->End);
+		Put(p, it->ValidCnt);
+		Put(p, float(it->MinVal));
+		Put(p, float(it->MaxVal));
+		Put(p, float(it->SumData));
+		Put(p, float(it->SumSquares));
+	}
+	const char* data = Compress(len);
+	zoom.Index.push_back(IndexItem(zoom.Block.front().ChromID, zoom.Block.front().Start,
+		zoom.Block.back().ChromID, zoom.Block.back().End, zoom.Size, len));
+	if( fwrite(data, 1, len, zoom.Tmp) != len )	_error = true;
+	zoom.Size += len;
+	zoom.Block.clear();
+}
+
+// Writes chromosomes B+ tree
+void BigWigFile::WriteChromTree()
+{
+	// keys are sorted chromosome names, IDs are in order of output
+	vector<pair<string,UINT> > keys;
+	UINT keySize = 1;
+	for(UINT i=0; i<_chroms.size(); i++) {
+		keys.push_back(make_pair(_chroms[i], i));
+		if( keySize < _chroms[i].length() )		keySize = UINT(_chroms[i].length());
+	}
+	sort(keys.begin(), keys.end());
+	const UINT blockSize = max(min(UINT(keys.size()), UINT(BLOCK_SIZE)), UINT(1));
+	const size_t leafSize = NODE_HEAD_SIZE + blockSize * (keySize + 2 * sizeof(UINT)),
+				 nodeSize = NODE_HEAD_SIZE + blockSize * (keySize + sizeof(ULLONG));
+	const ULLONG cnt = keys.size();
+	vector<ULLONG> nodeCnts;
+	CountNodes(cnt, blockSize, nodeCnts);
+	char* p;
+
+	// header
+	_block.assign(max(max(leafSize, nodeSize), size_t(BPT_HEAD_SIZE)), 0);
+	p = &_block[0];
+	Put(p, UINT(BPT_MAGIC));
+	Put(p, blockSize);
+	Put(p, keySize);
+	Put(p, UINT(2 * sizeof(UINT)));	// value size: ID and size
+	Put(p, cnt);
+	Put(p, ULLONG(0));				// reserved
+	Write(&_block[0], BPT_HEAD_SIZE);
+	// offsets of levels: the root is written first
+	vector<ULLONG> levelOffsets(nodeCnts.size());
+	ULLONG offset = _offset;
+	for(int j=int(nodeCnts.size())-1; j>=0; j--) {
+		levelOffsets[j] = offset;
+		offset += nodeCnts[j] * (j ? nodeSize : leafSize);
+	}
+	// non-leaf levels: item is the first key of child and its offset
+	ULLONG childSpan = 1;	// number of keys covered by child
+	for(size_t j=1; j<nodeCnts.size(); j++)	childSpan *= blockSize;
+	for(size_t j=nodeCnts.size()-1; j>0; j--, childSpan /= blockSize)
+		for(ULLONG n=0; n<nodeCnts[j]; n++) {
+			const ULLONG child = n * blockSize;
+			const USHORT childCnt = USHORT(min(ULLONG(blockSize), nodeCnts[j-1] - child));
+			memset(&_block[0], 0, nodeSize);
+			p = &_block[0];
+			Put(p, BYTE(0));		// not a leaf
+			Put(p, BYTE(0));		// reserved
+			Put(p, childCnt);
+			for(ULLONG c=child; c<child+childCnt; c++) {
+				const string& key = keys[size_t(c * childSpan)].first;
+				memcpy(p, key.c_str(), key.length());
+				p += keySize;
+				Put(p, levelOffsets[j-1] + c * (j > 1 ? nodeSize : leafSize));
+			}
+			Write(&_block[0], nodeSize);
+		}
+	// leaves: item is the key, chromosome's ID and size
+	for(ULLONG n=0; n<nodeCnts[0]; n++) {
+		const size_t first = size_t(n * blockSize);
+		const USHORT keyCnt = USHORT(min(ULLONG(blockSize), cnt - first));
+		memset(&_block[0], 0, leafSize);
+		p = &_block[0];
+		Put(p, BYTE(1));			// leaf
+		Put(p, BYTE(0));			// reserved
+		Put(p, keyCnt);
+		for(size_t i=first; i<first+keyCnt; i++) {
+			memcpy(p, keys[i].first.c_str(), keys[i].first.length());
+			p += keySize;
+			Put(p, keys[i].second);
+			Put(p, _sizes[keys[i].first]);
+		}
+		Write(&_block[0], leafSize);
+	}
+}
+
+// Writes R-tree index
+//	@items: leaf items
+void BigWigFile::WriteIndex(const vector<IndexItem>& items)
+{
+	const size_t leafSize = NODE_HEAD_SIZE + BLOCK_SIZE * CIR_LEAF_SIZE,
+				 nodeSize = NODE_HEAD_SIZE + BLOCK_SIZE * CIR_NODE_SIZE;
+	const ULLONG cnt = items.size();
+	vector<ULLONG> nodeCnts;
+	CountNodes(cnt, BLOCK_SIZE, nodeCnts);
+	char* p;
+
+	// header
+	_block.assign(leafSize, 0);
+	p = &_block[0];
+	Put(p, UINT(CIR_MAGIC));
+	Put(p, UINT(BLOCK_SIZE));
+	Put(p, cnt);
+	if( cnt ) {
+		Put(p, items.front().StartChrom);
+		Put(p, items.front().StartBase);
+		Put(p, items.back().EndChrom);
+		Put(p, items.back().EndBase);
+	}
+	else	p += 4 * sizeof(UINT);
+	Put(p, _offset);				// end of indexed data
+	Put(p, UINT(1));				// items per slot
+	Put(p, UINT(0));				// reserved
+	Write(&_block[0], CIR_HEAD_SIZE);
+	// offsets of levels: the root is written first
+	vector<ULLONG> levelOffsets(nodeCnts.size());
+	ULLONG offset = _offset;
+	for(int j=int(nodeCnts.size())-1; j>=0; j--) {
+		levelOffsets[j] = offset;
+		offset += nodeCnts[j] * (j ? nodeSize : leafSize);
+	}
+	// non-leaf levels: item is the bounds of child and its offset
+	ULLONG childSpan = 1;	// number of leaf items covered by child
+	for(size_t j=1; j<nodeCnts.size(); j++)	childSpan *= BLOCK_SIZE;
+	for(size_t j=nodeCnts.size()-1; j>0; j--, childSpan /= BLOCK_SIZE)
+		for(ULLONG n=0; n<nodeCnts[j]; n++) {
+			const ULLONG child = n * BLOCK_SIZE;
+			const USHORT childCnt = USHORT(min(ULLONG(BLOCK_SIZE), nodeCnts[j-1] - child));
+			memset(&_block[0], 0, nodeSize);
+			p = &_block[0];
+			Put(p, BYTE(0));		// not a leaf
+			Put(p, BYTE(0));		// reserved
+			Put(p, childCnt);
+			for(ULLONG c=child; c<child+childCnt; c++) {
+				const IndexItem& first = items[size_t(c * childSpan)];
+				const IndexItem& last = items[size_t(min((c + 1) * childSpan, cnt) - 1)];
+				Put(p, first.StartChrom);
+				Put(p, first.StartBase);
+				Put(p, last.EndChrom);
+				Put(p, last.EndBase);
+				Put(p, levelOffsets[j-1] + c * (j > 1 ? nodeSize : leafSize));
+			}
+			Write(&_block[0], nodeSize);
+		}
+	// leaves: item is the bounds of data block and its place in file
+	for(ULLONG n=0; n<nodeCnts[0]; n++) {
+		const size_t first = size_t(n * BLOCK_SIZE);
+		const USHORT itemCnt = USHORT(min(ULLONG(BLOCK_SIZE), cnt - first));
+		memset(&_block[0], 0, leafSize);
+		p = &_block[0];
+		Put(p, BYTE(1));			// leaf
+		Put(p, BYTE(0));			// reserved
+		Put(p, itemCnt);
+		for(vector<IndexItem>::const_iterator it=items.begin()+first; it!=items.begin()+first+itemCnt; it++) {
+			Put(p, it->StartChrom);
+			Put(p, it->StartBase);
+			Put(p, it->EndChrom);
+			Put(p, it->EndBase);
+			Put(p, it->Offset);
+			Put(p, it->Size);
+		}
+		Write(&_block[0], leafSize);
+	}
+}
+
+// Writes the rest of data, indexes, zoom levels and header, and closes file
+//	return: true if successful
+bool BigWigFile::Close()
+{
+	if( !_file )	return !_error;
+	WriteSection();
+	for(Zoom* zoom = _zooms; zoom < _zooms + _zoomCnt; zoom++) {
+		if( zoom->Curr.ValidCnt )	PushSummary(*zoom);
+		WriteZoomBlock(*zoom);
+	}
+	const ULLONG indexOffset = _offset;
+	WriteIndex(_index);
+	const ULLONG chromTreeOffset = _offset;
+	WriteChromTree();
+
+	// zoom levels: each one should reduce the number of summaries at least twice
+	ULLONG zoomOffsets[MAX_ZOOM_CNT][2];	// offsets of data and index
+	BYTE zoomCnt = 0;
+	if( _block.size() < BASE_BLK_SIZE )		_block.resize(BASE_BLK_SIZE);
+	for(ULLONG cnt = _itemCnt; zoomCnt < _zoomCnt; zoomCnt++) {
+		Zoom& zoom = _zooms[zoomCnt];
+		if( !zoom.Count || (zoom.Count << 1) > cnt )	break;
+		cnt = zoom.Count;
+		const UINT sumCnt = UINT(zoom.Count);
+		zoomOffsets[zoomCnt][0] = _offset;
+		Write(&sumCnt, sizeof(UINT));
+		// copy compressed blocks
+		rewind(zoom.Tmp);
+		for(size_t len; (len = fread(&_block[0], 1, _block.size(), zoom.Tmp)) > 0; )
+			Write(&_block[0], len);
+		if( ferror(zoom.Tmp) )	_error = true;
+		for(vector<IndexItem>::iterator it=zoom.Index.begin(); it!=zoom.Index.end(); it++)
+			it->Offset += zoomOffsets[zoomCnt][0] + sizeof(UINT);
+		zoomOffsets[zoomCnt][1] = _offset;
+		WriteIndex(zoom.Index);
+	}
+
+	// header, zoom headers, total summary and number of sections
+	_block.assign(DATA_OFFSET + sizeof(ULLONG), 0);
+	char* p = &_block[0];
+	Put(p, UINT(BW_MAGIC));
+	Put(p, USHORT(BW_VERSION));
+	Put(p, USHORT(zoomCnt));
+	Put(p, chromTreeOffset);
+	Put(p, ULLONG(DATA_OFFSET));
+	Put(p, indexOffset);
+	Put(p, USHORT(0));				// number of fields
+	Put(p, USHORT(0));				// number of defined fields
+	Put(p, ULLONG(0));				// autoSql offset
+	Put(p, ULLONG(SUMMARY_OFFSET));
+#ifdef _NO_ZLIB
+	Put(p, UINT(0));				// data are not compressed
+#else
+	Put(p, _maxBlockLen);
+#endif
+	Put(p, ULLONG(0));				// extension offset
+	for(BYTE i=0; i<zoomCnt; i++) {
+		Put(p, _zooms[i].Reduction);
+		Put(p, UINT(0));			// reserved
+		Put(p, zoomOffsets[i][0]);
+		Put(p, zoomOffsets[i][1]);
+	}
+	p = &_block[SUMMARY_OFFSET];
+	Put(p, _basesCnt);
+	Put(p, _total.MinVal);
+	Put(p, _total.MaxVal);
+	Put(p, _total.SumData);
+	Put(p, _total.SumSquares);
+	Put(p, _sectCnt);
+	if( fseek(_file, 0, SEEK_SET) || fwrite(&_block[0], 1, _block.size(), _file) != _block.size() )
+		_error = true;
+	if( fclose(_file) )		_error = true;
+	_file = NULL;
+	return !_error;
+}
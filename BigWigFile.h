@@ -0,0 +1,124 @@
+#pragma once
+#include "TxtFile.h"
+#include <map>
+
+// 'BigWigFile' writes wiggle records in bigWig format.
+// Records are streamed in chromosome order; data sections, their R-tree index
+// and zoom levels are built in one pass, then the header is completed at closing.
+// Zoom summaries are kept in temporary files until closing.
+// Values are written in native byte order, which is recognized by readers by the magic number.
+class BigWigFile
+{
+private:
+	// 'Item' is a bedGraph item of data section
+	struct Item {
+		chrlen	Start, End;		// 0-based half-open interval
+		float	Val;
+	};
+
+	// 'Summary' is a zoom level summary
+	struct Summary {
+		UINT	ChromID;
+		chrlen	Start, End;
+		UINT	ValidCnt;		// number of bases with data
+		double	MinVal, MaxVal, SumData, SumSquares;
+	};
+
+	// 'IndexItem' is an R-tree leaf item: the bounds of data block and its place in file
+	struct IndexItem {
+		UINT	StartChrom;
+		chrlen	StartBase;
+		UINT	EndChrom;
+		chrlen	EndBase;
+		ULLONG	Offset, Size;
+
+		inline IndexItem(UINT chrom, chrlen start, UINT endChrom, chrlen end, ULLONG offset, ULLONG size)
+			: StartChrom(chrom), StartBase(start), EndChrom(endChrom), EndBase(end),
+			Offset(offset), Size(size) {}
+	};
+
+	// 'Zoom' accumulates summaries of one zoom level
+	struct Zoom {
+		UINT	Reduction;			// length of summarized region
+		FILE*	Tmp;				// compressed blocks of summaries
+		ULLONG	Size;				// size of temporary file
+		ULLONG	Count;				// number of summaries
+		Summary	Curr;				// current summary; empty if ValidCnt is 0
+		vector<Summary>		Block;	// current block of summaries
+		vector<IndexItem>	Index;	// blocks; offsets are relative to the temporary file
+	};
+
+	FILE*	_file;
+	const char*	_sizesName;		// name of chrom.sizes file
+	map<string,chrlen>	_sizes;	// chromosome sizes
+	vector<string>	_chroms;	// names of output chromosomes in order of ID
+	chrlen	_chromSize;			// size of current chromosome
+	chrlen	_lastEnd;			// end of last item of current chromosome
+	vector<Item>	_items;		// current data section
+	vector<IndexItem> _index;	// data sections
+	ULLONG	_offset;			// current file offset
+	ULLONG	_sectCnt;			// number of data sections
+	ULLONG	_itemCnt;			// number of items
+	ULLONG	_basesCnt;			// number of bases with data
+	Summary	_total;				// total summary; only values are used
+	UINT	_maxBlockLen;		// maximum uncompressed block length
+	Zoom*	_zooms;				// zoom levels; NULL until the first data section is written
+	BYTE	_zoomCnt;			// number of zoom levels
+	vector<char>	_block;		// serialized block
+	vector<char>	_zBlock;	// compressed block
+	bool	_error;				// true if writing is failed
+
+	// Writes data to file
+	void Write(const void* data, size_t len);
+
+	// Compresses serialized block
+	//	@len: length of serialized block
+	//	return: compressed block and its length in @len
+	const char* Compress(UINT& len);
+
+	// Writes current data section
+	void WriteSection();
+
+	// Creates zoom levels with reductions based on the average length of items
+	void InitZooms();
+
+	// Adds item to zoom summaries
+	//	@chrom: chromosome's ID
+	//	@item: added item
+	void AddZoomItem(UINT chrom, const Item& item);
+
+	// Moves current summary to the block of zoom level
+	void PushSummary(Zoom& zoom);
+
+	// Writes current block of zoom level to its temporary file
+	void WriteZoomBlock(Zoom& zoom);
+
+	// Writes chromosomes B+ tree
+	void WriteChromTree();
+
+	// Writes R-tree index
+	//	@items: leaf items
+	void WriteIndex(const vector<IndexItem>& items);
+
+public:
+	// Creates new instance
+	//	@fName: file name
+	//	@chromSizes: name of chrom.sizes file
+	BigWigFile(const char* fName, const char* chromSizes);
+
+	~BigWigFile();
+
+	// Sets current chromosome
+	//	@name: chromosome's name
+	void SetChrom(const string& name);
+
+	// Adds records of current chromosome.
+	// Records outside chromosome are clipped, overlapped ones are clipped by previous one.
+	//	@recs: records
+	//	@cnt: number of records
+	void Add(const TrackRecord* recs, size_t cnt);
+
+	// Writes the rest of data, indexes, zoom levels and header, and closes file
+	//	return: true if successful
+	bool Close();
+};
@@ -1,9 +1,828 @@
 #include "TxtFile.h"
 
+#if defined _MULTITHREAD && !defined _NO_ZLIB
+/************************ class Unzipper ************************/
+
+#define BGZF_HEAD_SIZE	18		// length of BGZF member's header
+#define BGZF_TAIL_SIZE	8		// length of BGZF member's footer: CRC32 and ISIZE
+#define GZ_HEAD_SIZE	10		// length of gzip member's fixed header
+#define GZ_TAIL_SIZE	8		// length of gzip member's footer: CRC32 and ISIZE
+#define UNZIP_OUT_STEP	(4 * UNZIP_CHUNK_SIZE)	// increment of inflated chunk's buffer
+#define DEFL_MAXBITS	15		// maximum length of deflate Huffman code
+#define DEFL_CL_CNT		19		// number of code length symbols
+
+// Two windows marking chars copied from the unknown window:
+// window position is encoded by the pair of different chars, which are 255-based digits
+static struct MarkWindows {
+	char	Lo[UNZIP_WINDOW];	// the lower digit, skipping the value of the higher one
+	char	Hi[UNZIP_WINDOW];	// the higher digit
+
+	MarkWindows()
+	{
+		for(size_t i = 0; i < UNZIP_WINDOW; i++) {
+			const BYTE hi = BYTE(i / 255), lo = BYTE(i % 255);
+			Hi[i] = char(hi);
+			Lo[i] = char(lo < hi ? lo : lo + 1);
+		}
+	}
+
+	// Returns window position encoded by the pair of different chars
+	inline size_t Pos(char lo, char hi) const
+	{
+		return size_t(BYTE(lo) < BYTE(hi) ? BYTE(lo) : BYTE(lo) - 1) + 255 * BYTE(hi);
+	}
+} MarkWindows;
+
+// Returns 64 bits of chars from the lowest bit of given one; bits after the chars are 0
+//	@c: chars
+//	@pos: bit offset in chars
+//	@len: number of chars
+inline ULLONG Bits64(const char* c, size_t pos, size_t len)
+{
+	ULLONG val = 0;
+	for(size_t i = pos >> 3, k = 0; k < sizeof(ULLONG) && i + k < len; k++)
+		val |= ULLONG(BYTE(c[i + k])) << (k << 3);
+	return val >> (pos & 7);
+}
+
+// Returns the next bits of deflate stream, or -1 if stream is ended
+//	@c: stream
+//	@pos: bit offset in stream, which is increased by the number of read bits
+//	@end: bit offset after stream
+//	@cnt: number of bits
+inline int GetBits(const char* c, size_t& pos, size_t end, BYTE cnt)
+{
+	if( pos + cnt > end )	return -1;
+	int val = 0;
+	for(BYTE i = 0; i < cnt; i++, pos++)
+		val |= ((BYTE(c[pos >> 3]) >> (pos & 7)) & 1) << i;
+	return val;
+}
+
+// Returns little-endian 32-bit value
+inline ULONG GetUInt32(const char* c)
+{
+	return ULONG(BYTE(c[0])) | ULONG(BYTE(c[1])) << 8 | ULONG(BYTE(c[2])) << 16 | ULONG(BYTE(c[3])) << 24;
+}
+
+// Returns true if deflate Huffman code is valid as it is checked by zlib:
+// it should not be over-subscribed, and incomplete code may have only one code of length 1
+//	@lens: lengths of codes
+//	@cnt: number of codes
+bool IsHuffCode(const BYTE* lens, int cnt)
+{
+	short counts[DEFL_MAXBITS + 1];
+	int left = 1;		// number of unused codes of current length
+
+	memset(counts, 0, sizeof(counts));
+	for(int i = 0; i < cnt; i++)	counts[lens[i]]++;
+	for(BYTE len = 1; len <= DEFL_MAXBITS; len++)
+		if( (left = (left << 1) - counts[len]) < 0 )	return false;
+	return !left || counts[0] + counts[1] == cnt;
+}
+
+// Returns true if gzip file is gzip one
+//	@fName: name of file
+bool Unzipper::IsGzip(const char* fName)
+{
+	FILE* file = fopen(fName, "rb");
+	if( !file )		return false;
+	char c[4];
+	const size_t len = fread(c, 1, sizeof(c), file);
+	fclose(file);
+	return IsMember(c, len);
+}
+
+// Searches for the beginning of chunk; thread procedure
+//	@chunk: chunk whose Start and Limit keep the batch range to search in bytes
+retThreadValType
+#ifdef OS_Windows
+	__stdcall
+#endif
+	Unzipper::Search(void* arg)
+{
+	Chunk& chunk = *(Chunk*)arg;
+
+	if( &chunk != &chunk.Owner->_chunks[1] )	// the second chunk is searched by the reading thread
+		Trace::Attach("inflate", &chunk);
+	Trace::Span span("block", "search");
+	chunk.Start = chunk.Owner->FindBlock(chunk.Start, chunk.Limit, chunk.InMember);
+	return retThreadValTrue;
+}
+
+// Inflates members and blocks of chunk; thread procedure
+//	@chunk: chunk to inflate
+retThreadValType
+#ifdef OS_Windows
+	__stdcall
+#endif
+	Unzipper::Inflate(void* arg)
+{
+	Chunk& chunk = *(Chunk*)arg;
+	const Unzipper& owner = *chunk.Owner;
+	const char* batch = &owner._batch[0];
+	const size_t batchLen = owner._batchLen;
+	// the first chunk is inflated by the reading thread with the true window
+	const bool first = &chunk == &owner._chunks[0];
+	bool inMember = chunk.InMember,
+		 clean = !inMember || first;	// true if data do not depend on the window
+	z_stream strm, mstrm;				// streams inflating with the first and second marking windows
+	size_t pos = chunk.Start,			// batch bit offset of current member or block
+		   dataLen = 0,					// current length of inflated content
+		   crcPos = 0;					// data offset after the part included in CRC32
+	ULONG crc = 0;						// CRC32 of current member's data in chunk
+	int res = Z_OK;
+
+	if( !first )	Trace::Attach("inflate", &chunk);
+	Trace::Span span("block", "inflate");
+	memset(&strm, 0, sizeof(z_stream));
+	memset(&mstrm, 0, sizeof(z_stream));
+	chunk.DataLen = chunk.CleanLen = 0;
+	chunk.End = pos;
+	chunk.EndInMember = inMember;
+	chunk.Segments.clear();
+	if( (chunk.Error = inflateInit2(&strm, -MAX_WBITS) != Z_OK) )	return retThreadValTrue;
+	if( inMember ) {
+		if( first )
+			inflateSetDictionary(&strm, (const Bytef*)&owner._window[0], uInt(owner._windowLen));
+		else {
+			if( (chunk.Error = inflateInit2(&mstrm, -MAX_WBITS) != Z_OK) ) {
+				inflateEnd(&strm);
+				return retThreadValTrue;
+			}
+			inflateSetDictionary(&strm, (const Bytef*)MarkWindows.Lo, UNZIP_WINDOW);
+			inflateSetDictionary(&mstrm, (const Bytef*)MarkWindows.Hi, UNZIP_WINDOW);
+			const BYTE shift = BYTE(pos & 7);
+			if( shift )		inflatePrime(&mstrm, 8 - shift, BYTE(batch[pos >> 3]) >> shift);
+			mstrm.next_in = (Bytef*)batch + (pos >> 3) + (shift > 0);
+			mstrm.avail_in = uInt(batchLen - (pos >> 3) - (shift > 0));
+		}
+	}
+
+	for(;;) {
+		if( !inMember ) {				// beginning of member
+			if( pos >= chunk.Limit )	break;
+			const int len = HeaderLen(batch + (pos >> 3), batchLen - (pos >> 3));
+			if( len <= 0 ) {			// member is not completed by the batch or it is invalid
+				chunk.Error = len < 0;
+				break;
+			}
+			pos += size_t(len) << 3;
+			inflateReset(&strm);
+			inMember = true;
+		}
+		// inflate from the bit offset
+		const size_t ind = pos >> 3;
+		const BYTE shift = BYTE(pos & 7);
+		if( shift )		inflatePrime(&strm, 8 - shift, BYTE(batch[ind]) >> shift);
+		strm.next_in = (Bytef*)batch + ind + (shift > 0);
+		strm.avail_in = uInt(batchLen - ind - (shift > 0));
+		do {							// inflate the next block
+			if( chunk.Data.size() == dataLen ) {
+				chunk.Data.resize(dataLen + UNZIP_OUT_STEP);
+				Memory::Add(Memory::UNZIP, UNZIP_OUT_STEP);
+			}
+			strm.next_out = (Bytef*)&chunk.Data[dataLen];
+			strm.avail_out = uInt(chunk.Data.size() - dataLen);
+			res = inflate(&strm, Z_BLOCK);
+			dataLen = chunk.Data.size() - strm.avail_out;
+			if( res == Z_OK && !(strm.data_type & 128) )	continue;	// block is not ended yet
+			if( res != Z_OK && res != Z_STREAM_END )	break;
+			if( !clean ) {				// inflate the same data with the second marking window
+				if( chunk.Marks.size() < dataLen ) {
+					Memory::Add(Memory::UNZIP, chunk.Data.size() - chunk.Marks.size());
+					chunk.Marks.resize(chunk.Data.size());
+				}
+				size_t markLen = mstrm.total_out;
+				while( markLen < dataLen ) {
+					mstrm.next_out = (Bytef*)&chunk.Marks[markLen];
+					mstrm.avail_out = uInt(dataLen - markLen);
+					const int mres = inflate(&mstrm, Z_NO_FLUSH);
+					markLen = dataLen - mstrm.avail_out;
+					if( mres != Z_OK && !(mres == Z_STREAM_END && markLen == dataLen) ) {
+						res = Z_DATA_ERROR;
+						break;
+					}
+				}
+				if( res == Z_DATA_ERROR )	break;
+				// the end of member or the last window length of data without marks
+				if( res == Z_STREAM_END || (dataLen >= UNZIP_WINDOW
+				&& !memcmp(&chunk.Data[dataLen - UNZIP_WINDOW], &chunk.Marks[dataLen - UNZIP_WINDOW], UNZIP_WINDOW)) ) {
+					clean = true;
+					chunk.CleanLen = crcPos = dataLen;
+					inflateEnd(&mstrm);
+				}
+			}
+			if( res != Z_OK )	break;
+			// block is ended
+			pos = ((batchLen - strm.avail_in) << 3) - (strm.data_type & 7);
+			if( clean ) {
+				crc = crc32(crc, (Bytef*)&chunk.Data[crcPos], uInt(dataLen - crcPos));
+				crcPos = dataLen;
+			}
+			chunk.DataLen = dataLen;
+			chunk.End = pos;
+			chunk.EndInMember = true;
+		} while( pos < chunk.Limit );
+		if( res != Z_STREAM_END ) {
+			// chunk is completed, block is not completed by the batch or it is invalid
+			chunk.Error = res != Z_OK && !(res == Z_BUF_ERROR && !strm.avail_in);
+			break;
+		}
+		// member is ended
+		pos = (((batchLen - strm.avail_in) << 3) - (strm.data_type & 7) + 7) >> 3;
+		if( pos + GZ_TAIL_SIZE > batchLen )	break;	// footer is not completed by the batch
+		const Segment seg = {
+			dataLen,
+			crc32(crc, (Bytef*)&chunk.Data[crcPos], uInt(dataLen - crcPos)),
+			GetUInt32(batch + pos),
+			GetUInt32(batch + pos + 4),
+			true
+		};
+		chunk.Segments.push_back(seg);
+		crc = 0;
+		crcPos = chunk.DataLen = dataLen;
+		chunk.End = pos = (pos + GZ_TAIL_SIZE) << 3;
+		chunk.EndInMember = inMember = false;
+	}
+	if( !clean ) {
+		chunk.CleanLen = chunk.DataLen;
+		inflateEnd(&mstrm);
+	}
+	if( chunk.EndInMember ) {			// the rest of member
+		const Segment seg = { chunk.DataLen, crc, 0, 0, false };
+		chunk.Segments.push_back(seg);
+	}
+	inflateEnd(&strm);
+	return retThreadValTrue;
+}
+
+// Returns the length of BGZF member, or 0 if it is not BGZF member
+//	@c: supposed beginning of member
+//	@len: number of available chars
+size_t Unzipper::BgzfLen(const char* c, size_t len)
+{
+	if( len < BGZF_HEAD_SIZE )	return 0;
+	// magic, deflate method, extra field of 6 bytes with 'BC' subfield of 2 bytes
+	if( BYTE(c[0]) == 0x1f && BYTE(c[1]) == 0x8b && c[2] == Z_DEFLATED && (c[3] & 4)
+	&& c[10] == 6 && !c[11] && c[12] == 'B' && c[13] == 'C' && c[14] == 2 && !c[15] )
+		return (BYTE(c[16]) | (BYTE(c[17]) << 8)) + 1;
+	return 0;
+}
+
+// Returns true if member supposedly begins by given chars
+//	@c: supposed beginning of member
+//	@len: number of available chars
+bool Unzipper::IsMember(const char* c, size_t len)
+{
+	// magic, deflate method and no reserved flags
+	return len >= 4 && BYTE(c[0]) == 0x1f && BYTE(c[1]) == 0x8b && c[2] == Z_DEFLATED && !(c[3] & 0xe0);
+}
+
+// Returns the length of member's header, 0 if header is not complete, or -1 if it is invalid
+//	@c: supposed beginning of member
+//	@len: number of available chars
+int Unzipper::HeaderLen(const char* c, size_t len)
+{
+	if( len < 4 )	return 0;
+	if( !IsMember(c, len) )		return -1;
+	const BYTE flags = BYTE(c[3]);
+	size_t i = GZ_HEAD_SIZE;
+	const char* end;
+
+	if( flags & 4 ) {			// extra field
+		if( i + 2 > len )	return 0;
+		i += 2 + (BYTE(c[i]) | (BYTE(c[i + 1]) << 8));
+	}
+	for(BYTE f = 8; f <= 16; f <<= 1)	// zero-terminated file name and comment
+		if( flags & f ) {
+			if( i >= len || !(end = (const char*)memchr(c + i, 0, len - i)) )	return 0;
+			i = end - c + 1;
+		}
+	if( flags & 2 )		i += 2;	// header's CRC16
+	return i <= len ? int(i) : 0;
+}
+
+// Returns true if valid header of dynamic Huffman block, which is not the last one, begins at batch bit offset
+//	@pos: batch bit offset
+bool Unzipper::IsBlock(size_t pos) const
+{
+	static const BYTE Order[] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+	const char* batch = &_batch[0];
+	const size_t end = _batchLen << 3;
+	ULLONG bits = Bits64(batch, pos, _batchLen);
+	if( (bits & 7) != 4 )	return false;		// not the last block with dynamic codes
+	const int litCnt = 257 + int(bits >> 3 & 0x1f),
+			  cnt = litCnt + 1 + int(bits >> 8 & 0x1f);	// number of literal/length and distance codes
+	const BYTE clCnt = 4 + BYTE(bits >> 13 & 0xf);		// number of code length codes
+	if( litCnt > 286 || cnt - litCnt > 30 )		return false;
+
+	// code length code should be complete
+	BYTE lens[286 + 30];
+	UINT kraft = 0;
+	memset(lens, 0, DEFL_CL_CNT);
+	bits = Bits64(batch, pos += 17, _batchLen);
+	for(BYTE i = 0; i < clCnt; i++, bits >>= 3)
+		if( (lens[Order[i]] = BYTE(bits & 7)) != 0 )
+			kraft += 0x80 >> lens[Order[i]];
+	if( kraft != 0x80 || (pos += 3 * clCnt) > end )		return false;
+
+	// canonical code length code decoded bit by bit as in puff.c of zlib
+	short counts[8], symbols[DEFL_CL_CNT], offs[8];
+	memset(counts, 0, sizeof(counts));
+	for(BYTE i = 0; i < DEFL_CL_CNT; i++)	counts[lens[i]]++;
+	offs[1] = 0;
+	for(BYTE len = 1; len < 7; len++)	offs[len + 1] = offs[len] + counts[len];
+	for(BYTE i = 0; i < DEFL_CL_CNT; i++)
+		if( lens[i] )	symbols[offs[lens[i]]++] = i;
+
+	// lengths of literal/length and distance codes
+	for(int i = 0; i < cnt; ) {
+		int sym = -1, code = 0, first = 0, ind = 0, bit, rep;
+		for(BYTE len = 1; len < 8; len++) {
+			if( (bit = GetBits(batch, pos, end, 1)) < 0 )	return false;
+			code |= bit;
+			if( code - counts[len] < first )	{ sym = symbols[ind + code - first]; break; }
+			ind += counts[len];
+			first = (first + counts[len]) << 1;
+			code <<= 1;
+		}
+		if( sym < 16 )	{ lens[i++] = BYTE(sym); continue; }
+		BYTE len = 0;
+		if( sym == 16 ) {
+			if( !i )	return false;	// no previous length
+			len = lens[i - 1];
+			rep = GetBits(batch, pos, end, 2) + 3;
+		}
+		else if( sym == 17 )	rep = GetBits(batch, pos, end, 3) + 3;
+		else					rep = GetBits(batch, pos, end, 7) + 11;
+		if( rep < 3 || i + rep > cnt )	return false;
+		for(; rep; rep--)	lens[i++] = len;
+	}
+	return lens[256]				// end-of-block code
+		&& IsHuffCode(lens, litCnt) && IsHuffCode(lens + litCnt, cnt - litCnt);
+}
+
+// Returns batch offset of the supposed beginning of member, or 0 if it is not found
+//	@from: batch offset to start searching
+//	@to: batch offset to stop searching
+size_t Unzipper::FindMember(size_t from, size_t to) const
+{
+	const char* batch = &_batch[0];
+	const char* c;
+
+	if( to > _batchLen )	to = _batchLen;
+	for(; from < to; from = c - batch + 1) {
+		c = (const char*)memchr(batch + from, 0x1f, to - from);
+		if( !c )	break;
+		if( IsMember(c, _batchLen - (c - batch)) )	return c - batch;
+	}
+	return 0;
+}
+
+// Returns batch bit offset of the supposed beginning of member or block, or 0 if it is not found
+//	@from: batch offset to start searching
+//	@to: batch offset to stop searching
+//	@inMember: returned true if block is found
+size_t Unzipper::FindBlock(size_t from, size_t to, bool& inMember) const
+{
+	const char* batch = &_batch[0];
+
+	if( to > _batchLen )	to = _batchLen;
+	for(; from < to; from++) {
+		if( batch[from] == char(0x1f) && IsMember(batch + from, _batchLen - from) ) {
+			inMember = false;
+			return from << 3;
+		}
+		const ULLONG bits = Bits64(batch, from << 3, _batchLen);
+		for(BYTE shift = 0; shift < 8; shift++) {
+			const ULLONG head = bits >> shift;
+			// not the last dynamic block, no more than 286 literal/length and 30 distance codes
+			if( (head & 7) == 4 && (head >> 3 & 0x1f) < 30 && (head >> 8 & 0x1f) < 30
+			&& IsBlock((from << 3) + shift) ) {
+				inMember = true;
+				return (from << 3) + shift;
+			}
+		}
+	}
+	return 0;
+}
+
+// Replaces marks in the beginning of chunk depending on the window by chars of the true window
+//	@chunk: accepted chunk
+//	return: false if data are invalid
+bool Unzipper::Patch(Chunk& chunk)
+{
+	Trace::Span span("block", "patch");
+	char* data = &chunk.Data[0];
+	const char* marks = &chunk.Marks[0];
+	const size_t winStart = UNZIP_WINDOW - _windowLen;	// the first window position of the true window
+
+	for(size_t i = 0; i < chunk.CleanLen; i++)
+		if( data[i] != marks[i] ) {		// char is copied from the window
+			const size_t pos = MarkWindows.Pos(data[i], marks[i]);
+			if( pos < winStart )	return false;	// reference before the beginning of stream
+			data[i] = _window[pos - winStart];
+		}
+	// complete CRC32 of the first segment
+	Segment& seg = chunk.Segments[0];
+	seg.Crc = crc32_combine(crc32(0, (Bytef*)data, uInt(chunk.CleanLen)),
+		seg.Crc, z_off_t(seg.End - chunk.CleanLen));
+	return true;
+}
+
+// Checks CRC32 and length of members ended in chunk and keeps the last data as the window
+//	@chunk: accepted chunk
+//	return: false if member is corrupted
+bool Unzipper::Accept(const Chunk& chunk)
+{
+	size_t start = 0;	// data offset of segment
+
+	for(size_t i = 0; i < chunk.Segments.size(); i++) {
+		const Segment& seg = chunk.Segments[i];
+		_memberCrc = crc32_combine(_memberCrc, seg.Crc, z_off_t(seg.End - start));
+		_memberLen += seg.End - start;
+		if( seg.Closed ) {
+			if( _memberCrc != seg.MemberCrc || ULONG(_memberLen & 0xffffffff) != seg.MemberLen )
+				return false;
+			_memberCrc = 0;
+			_memberLen = 0;
+		}
+		start = seg.End;
+	}
+	// keep the last window length of inflated data
+	const size_t len = min(chunk.DataLen, size_t(UNZIP_WINDOW));
+	if( _windowLen + len > UNZIP_WINDOW ) {
+		const size_t keepLen = UNZIP_WINDOW - len;
+		memmove(&_window[0], &_window[_windowLen - keepLen], keepLen);
+		_windowLen = keepLen;
+	}
+	if( len )	memcpy(&_window[_windowLen], &chunk.Data[chunk.DataLen - len], len);
+	_windowLen += len;
+	return true;
+}
+
+// Reads and inflates the next batch.
+//	return: 1 if batch is inflated; 0 if file is finished; -1 if unsuccess reading
+int Unzipper::ReadBatch()
+{
+	Trace::Span span("block", "read batch");
+
+	for(;;) {
+		// move untreated rest to the beginning of batch and read the next part
+		const size_t ind = _consumed >> 3;
+		size_t len = _batchLen - ind;
+		if( len )	memmove(&_batch[0], &_batch[ind], len);
+		const size_t readLen = fread(&_batch[len], 1, _batch.size() - len, _file);
+		_batchLen = len + readLen;
+		_inLen += readLen;
+		_consumed &= 7;
+		const size_t start = _consumed;	// batch bit offset of the untreated rest
+		_chunkInd = _chunkCnt = 0;
+		_dataPos = 0;
+		if( ferror(_file) )	return -1;
+		_eof = _batchLen < _batch.size();
+		if( !_batchLen )	return 0;
+
+		// split batch into chunks beginning by supposed members or blocks
+		const size_t step = _batchLen / _chunks.size();
+		BYTE cnt = 1, i;
+		_chunks[0].Start = start;
+		_chunks[0].InMember = _inMember;
+		if( BgzfLen(&_batch[0], _batchLen) ) {
+			size_t pos = 0;		// BGZF member's offset
+			for(i = 1; i < _chunks.size(); i++) {
+				// follow the chain of BGZF members to the chunk's nominal beginning
+				while( pos < i * step && (len = BgzfLen(&_batch[pos], _batchLen - pos)) != 0 )
+					pos += len;
+				_chunks[i].Start = (pos >= i * step && pos < _batchLen ?
+					pos : FindMember(i * step, (i + 1) * step)) << 3;
+				_chunks[i].InMember = false;
+			}
+		}
+		else if( _chunks.size() > 1 ) {	// search in parallel
+			vector<Thread*> threads(_chunks.size() - 2);
+			for(i = 1; i < _chunks.size(); i++) {
+				_chunks[i].Start = i * step;
+				_chunks[i].Limit = (i + 1) * step;
+				if( i > 1 )		threads[i - 2] = new Thread(Search, &_chunks[i]);
+			}
+			Search(&_chunks[1]);
+			for(i = 0; i < threads.size(); i++) {
+				threads[i]->WaitFor();
+				delete threads[i];
+			}
+		}
+		for(i = 1; i < _chunks.size(); i++)
+			if( _chunks[i].Start > _chunks[cnt - 1].Start ) {
+				_chunks[cnt].InMember = _chunks[i].InMember;
+				_chunks[cnt++].Start = _chunks[i].Start;
+			}
+		for(i = 0; i < cnt; i++)
+			_chunks[i].Limit = i + 1 < cnt ? _chunks[i + 1].Start : _batchLen << 3;
+
+		// inflate chunks in parallel
+		vector<Thread*> threads(cnt - 1);
+		Trace::Counter("inflated chunks", cnt);
+		for(i = 1; i < cnt; i++)
+			threads[i - 1] = new Thread(Inflate, &_chunks[i]);
+		Inflate(&_chunks[0]);
+		for(i = 0; i < cnt - 1; i++) {
+			threads[i]->WaitFor();
+			delete threads[i];
+		}
+		Trace::Counter("inflated chunks", 0);
+
+		// accept chunks while each of them starts where the previous one has ended
+		len = 0;
+		for(i = 0; i < cnt; i++) {
+			Chunk& chunk = _chunks[i];
+			if( i && (chunk.Start != _consumed || chunk.InMember != _inMember) )	break;
+			if( (chunk.CleanLen && !Patch(chunk)) || !Accept(chunk) )	return -1;
+			_consumed = chunk.End;
+			_inMember = chunk.EndInMember;
+			len += chunk.DataLen;
+		}
+		_chunkCnt = i;
+		if( len ) {
+			_dataLen += len;
+			return 1;
+		}
+		if( _chunks[0].Error ) {
+			// non-gzip data after the last member is ignored like gzread() does
+			if( !_dataLen || _inMember || IsMember(&_batch[_consumed >> 3], _batchLen - (_consumed >> 3)) )
+				return -1;
+			_consumed = _batchLen << 3;
+			_eof = true;
+			return 0;
+		}
+		if( _eof )		// truncated member
+			return !_inMember && _consumed == _batchLen << 3 ? 0 : -1;
+		if( _consumed == start ) {		// block or member is bigger than batch
+			Memory::Add(Memory::UNZIP, _batch.size());
+			_batch.resize(_batch.size() << 1);
+		}
+	}
+}
+
+// Creates new instance
+//	@file: opened gzip file
+//	@threadCnt: number of inflating threads
+Unzipper::Unzipper(FILE* file, BYTE threadCnt) :
+	_file(file),
+	_batch(threadCnt * UNZIP_CHUNK_SIZE),
+	_batchLen(0),
+	_consumed(0),
+	_inMember(false),
+	_chunks(threadCnt),
+	_chunkCnt(0),
+	_chunkInd(0),
+	_dataPos(0),
+	_dataLen(0),
+	_inLen(0),
+	_window(UNZIP_WINDOW),
+	_windowLen(0),
+	_memberCrc(0),
+	_memberLen(0),
+	_eof(false)
+{
+	for(BYTE i = 0; i < threadCnt; i++)
+		_chunks[i].Owner = this;
+	Memory::Add(Memory::UNZIP, Capacity());
+}
+
+// Returns the total length of batch and chunks' buffers
+size_t Unzipper::Capacity() const
+{
+	size_t len = _batch.size() + _window.size();
+
+	for(BYTE i = 0; i < _chunks.size(); i++)
+		len += _chunks[i].Data.size() + _chunks[i].Marks.size();
+	return len;
+}
+
+// Reads inflated chars.
+//	@buff: buffer to read
+//	@len: number of chars to read
+//	return: number of readed chars or -1 if unsuccess reading
+int Unzipper::Read(char* buff, UINT len)
+{
+	UINT readLen = 0;
+
+	while( readLen < len ) {
+		if( _chunkInd == _chunkCnt ) {		// all accepted chunks are readed
+			if( _eof && _consumed == _batchLen << 3 )	break;
+			int res = ReadBatch();
+			if( res < 0 )	return -1;
+			if( !res )		break;
+		}
+		const Chunk& chunk = _chunks[_chunkInd];
+		size_t size = min(size_t(len - readLen), chunk.DataLen - _dataPos);
+		memcpy(buff + readLen, &chunk.Data[_dataPos], size);
+		readLen += UINT(size);
+		if( (_dataPos += size) == chunk.DataLen ) {
+			_chunkInd++;
+			_dataPos = 0;
+		}
+	}
+	return int(readLen);
+}
+
+/************************ end of class Unzipper ************************/
+
+/************************ class Zipper ************************/
+
+// BGZF member's header; the last two bytes keep the length of member minus 1
+static const BYTE BgzfHead[BGZF_HEAD_SIZE] =
+	{ 0x1f, 0x8b, Z_DEFLATED, 4, 0, 0, 0, 0, 0, 0xff, 6, 0, 'B', 'C', 2, 0, 0, 0 };
+// BGZF end-of-file marker: empty member
+static const BYTE BgzfEOF[] = { 0x1f, 0x8b, Z_DEFLATED, 4, 0, 0, 0, 0, 0, 0xff, 6, 0,
+	'B', 'C', 2, 0, 0x1b, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+
+// Puts unsigned integer in little-endian order
+//	@dst: destination
+//	@val: value
+//	@size: number of bytes
+static inline void PutLE(char* dst, ULONG val, BYTE size)
+{
+	for(BYTE i = 0; i < size; i++, val >>= 8)
+		dst[i] = char(val & 0xff);
+}
+
+// Deflates part of batch into BGZF members; thread procedure
+//	@part: part to deflate
+retThreadValType
+#ifdef OS_Windows
+	__stdcall
+#endif
+	Zipper::Deflate(void* arg)
+{
+	Part& part = *(Part*)arg;
+	z_stream strm;
+
+	Trace::Attach("deflate", &part);
+	Trace::Span span("block", "deflate");
+	memset(&strm, 0, sizeof(z_stream));
+	part.OutLen = 0;
+	part.Error = deflateInit2(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+		-MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK;	// raw deflate
+	if( part.Error )	return retThreadValTrue;
+	const size_t maxLen = deflateBound(&strm, BGZF_BLOCK_SIZE);	// maximum length of deflated member's content
+	const size_t size = (part.DataLen / BGZF_BLOCK_SIZE + 1) * (BGZF_HEAD_SIZE + maxLen + BGZF_TAIL_SIZE);
+	if( part.Out.size() < size ) {
+		Memory::Add(Memory::ZIP, size - part.Out.size());
+		part.Out.resize(size);
+	}
+
+	for(size_t pos = 0; pos < part.DataLen; pos += BGZF_BLOCK_SIZE) {
+		const uInt len = uInt(min(part.DataLen - pos, size_t(BGZF_BLOCK_SIZE)));
+		char* out = &part.Out[part.OutLen];
+
+		deflateReset(&strm);
+		strm.next_in = (Bytef*)(part.Data + pos);
+		strm.avail_in = len;
+		strm.next_out = (Bytef*)(out + BGZF_HEAD_SIZE);
+		strm.avail_out = uInt(maxLen);
+		if( deflate(&strm, Z_FINISH) != Z_STREAM_END ) {
+			part.Error = true;
+			break;
+		}
+		const size_t memberLen = BGZF_HEAD_SIZE + strm.total_out + BGZF_TAIL_SIZE;
+		memcpy(out, BgzfHead, BGZF_HEAD_SIZE);
+		PutLE(out + BGZF_HEAD_SIZE - 2, ULONG(memberLen - 1), 2);
+		out += BGZF_HEAD_SIZE + strm.total_out;
+		PutLE(out, crc32(crc32(0, Z_NULL, 0), (const Bytef*)(part.Data + pos), len), 4);
+		PutLE(out + 4, len, 4);
+		part.OutLen += memberLen;
+	}
+	deflateEnd(&strm);
+	return retThreadValTrue;
+}
+
+// Starts deflating the accumulated batch and switches to another one
+void Zipper::StartBatch()
+{
+	Batch& batch = _batches[_ind];
+
+	for(size_t pos = 0, i = 0; pos < batch.DataLen; pos += ZIP_PART_SIZE, i++) {
+		Part& part = batch.Parts[i];
+		part.Data = &batch.Data[pos];
+		part.DataLen = min(batch.DataLen - pos, size_t(ZIP_PART_SIZE));
+		batch.Threads.push_back(new Thread(Deflate, &part));
+	}
+	Trace::Counter("deflated batches", DeflatedCount());
+	_ind = !_ind;
+	WriteBatch(_batches[_ind]);		// release the previous batch to accumulate
+}
+
+// Waits for deflating of batch and writes it
+//	@batch: batch to write
+void Zipper::WriteBatch(Batch& batch)
+{
+	Trace::Span span("block", "write batch");
+
+	for(BYTE i = 0; i < batch.Threads.size(); i++) {
+		const Part& part = batch.Parts[i];
+		batch.Threads[i]->WaitFor();
+		delete batch.Threads[i];
+		if( !_error && (part.Error || fwrite(&part.Out[0], 1, part.OutLen, _file) != part.OutLen) )
+			_error = true;
+	}
+	batch.Threads.clear();
+	batch.DataLen = 0;
+	Trace::Counter("deflated batches", DeflatedCount());
+}
+
+// Creates new instance
+//	@file: file opened for writing
+//	@threadCnt: number of deflating threads
+Zipper::Zipper(FILE* file, BYTE threadCnt) : _file(file), _ind(0), _error(false)
+{
+	for(BYTE i = 0; i < 2; i++) {
+		_batches[i].Data.resize(threadCnt * ZIP_PART_SIZE);
+		_batches[i].DataLen = 0;
+		_batches[i].Parts.resize(threadCnt);
+	}
+	Memory::Add(Memory::ZIP, Capacity());
+}
+
+// Returns the total length of batches' and parts' buffers
+size_t Zipper::Capacity() const
+{
+	size_t len = 0;
+
+	for(BYTE i = 0; i < 2; i++) {
+		len += _batches[i].Data.size();
+		for(BYTE k = 0; k < _batches[i].Parts.size(); k++)
+			len += _batches[i].Parts[k].Out.size();
+	}
+	return len;
+}
+
+// Adds chars to write.
+//	@data: chars to write
+//	@len: number of chars
+//	return: true if successful
+bool Zipper::Write(const char* data, size_t len)
+{
+	while( len ) {
+		Batch& batch = _batches[_ind];
+		const size_t size = min(len, batch.Data.size() - batch.DataLen);
+
+		memcpy(&batch.Data[batch.DataLen], data, size);
+		batch.DataLen += size;
+		data += size;
+		len -= size;
+		if( batch.DataLen == batch.Data.size() )	StartBatch();
+	}
+	return !_error;
+}
+
+// Writes all accumulated chars and BGZF end-of-file marker and closes file.
+//	return: true if successful
+bool Zipper::Close()
+{
+	if( _file ) {
+		StartBatch();
+		WriteBatch(_batches[!_ind]);
+		if( !_error && fwrite(BgzfEOF, 1, sizeof(BgzfEOF), _file) != sizeof(BgzfEOF) )
+			_error = true;
+		if( fclose(_file) )	_error = true;
+		_file = NULL;
+	}
+	return !_error;
+}
+
+/************************ end of class Zipper ************************/
+#endif	// _MULTITHREAD && !_NO_ZLIB
+
+/************************ class TxtBuffers ************************/
+
+// Gets kept buffer, increased if necessary
+//	@ind: index of buffer
+//	@len: required length
+char* TxtBuffers::Get(BYTE ind, UINT len)
+{
+	if( _lens[ind] < len ) {
+		delete [] _buffs[ind];
+		Memory::Add(Memory::READ, -LLONG(_lens[ind]));
+		_buffs[ind] = NULL;		// keep consistent state if allocation fails
+		_lens[ind] = 0;
+		_buffs[ind] = new char[len];
+		_lens[ind] = len;
+		Memory::Add(Memory::READ, len);
+	}
+	return _buffs[ind];
+}
+
+/************************ end of class TxtBuffers ************************/
+
 /************************ class TxtFile ************************/
 const char* modes[] = { "r", "w", "a+" };
 const char* bmodes[] = { "rb", "wb" };
 
+UINT TxtFile::BuffLen = NUMB_BLK * BASE_BLK_SIZE;
+
 // Sets error code and throws exception if it is allowed.
 void TxtFile::SetError(Err::eCode errCode) const
 {
@@ -17,23 +836,68 @@ void TxtFile::SetError(Err::eCode errCode) const
 //	@mode: opening mode
 //	@file: clonable file or NULL
 //	return: true if success, otherwise false.
-bool TxtFile::SetBasic(const string& fName, eAction mode, void* file)
+bool TxtFile::SetBasic(const string& fName, eAction mode, void* file, BYTE threadCnt)
 {
 	_buff = _buffLine = NULL;
 	_linesLen = NULL;
+	_buffers = NULL;
 	_stream = NULL;
 	_errCode = Err::NONE;
 	_fName = fName;
 	_currRecPos = _recLen = _cntRecords = _readingLen = 0;
+	_spill = _basic = NULL;
+	_spillLen = _basicLen = 0;
+	_progOffset = _progRecords = 0;
+	_readTotal = _readOffset = 0;
+#ifndef OS_Windows
+	_map = NULL;
+	_mapLen = 0;
+	_buffPos = 0;
+#endif
+#ifdef _MULTITHREAD
+	_raBuff[0] = _raBuff[1] = NULL;
+	_raThread = NULL;
+#endif
 #ifdef _NO_ZLIB
 	if(IsZipped()) { SetError(Err::FZ_BUILD); return false; }
 #endif
 	// set file stream
 	if(file)	_stream = file;
+	else if( IsFlag(STDIN) ) {		// duplicate descriptor to close stream as usual
+		int fd = dup(fileno(stdin));
+#ifndef _NO_ZLIB
+		// gzread() recognizes gzip stream by its magic bytes and reads plain text as is
+		if( fd >= 0 && !(_stream = gzdopen(fd, bmodes[mode])) )	close(fd);
+#else
+		if( fd >= 0 && !(_stream = fdopen(fd, modes[mode])) )	close(fd);
+		if( _stream ) {
+			int c = getc((FILE*)_stream);
+			if( c == 0x1f )	{ SetError(Err::FZ_BUILD); return false; }	// gzip magic byte
+			ungetc(c, (FILE*)_stream);
+		}
+#endif
+		if( _stream == NULL )	SetError(Err::F_OPEN);
+	}
 	else {
 #ifndef _NO_ZLIB
 		if(IsZipped())
 			if(mode == ALL)	SetError(Err::FZ_OPEN);
+#ifdef _MULTITHREAD
+			else if( mode == WRITE ) {		// write BGZF
+				FILE* file = fopen(fName.c_str(), bmodes[mode]);
+				if( file ) {
+					_stream = new Zipper(file, threadCnt);
+					RaiseFlag(ZIPPER);
+				}
+			}
+			else if( threadCnt > 1 && Unzipper::IsGzip(fName.c_str()) ) {
+				FILE* file = fopen(fName.c_str(), bmodes[mode]);
+				if( file ) {
+					_stream = new Unzipper(file, threadCnt);
+					RaiseFlag(UNZIPPER);
+				}
+			}
+#endif
 			else	_stream = gzopen(fName.c_str(), bmodes[mode]);
 		else
 #endif
@@ -48,9 +912,27 @@ bool TxtFile::SetBasic(const string& fName, eAction mode, void* file)
 bool TxtFile::CreateBuffer(eBuff buffType)
 {
 	try {
-		if( buffType == BUFF_BASIC )	_buff = new char[_buffLen];
+		if( buffType == BUFF_BASIC ) {
+			if( _buffers )	_buff = _buffers->Get(0, _buffLen);
+			else {
+				_buff = new char[_buffLen];
+				Memory::Add(IsFlag(WRMODE) ? Memory::WRITE : Memory::READ, _buffLen);
+			}
+		}
+#ifdef _MULTITHREAD
+		else if( buffType == BUFF_AHEAD )
+			for(BYTE i=0; i<2; i++) {
+				UINT len = _raHeadLen + _raBlkLen + 1;	// + 1 to close the last line
+				if( _buffers )	_raBuff[i] = _buffers->Get(i, len);
+				else {
+					_raBuff[i] = new char[len];
+					Memory::Add(Memory::READ_AHEAD, len);
+				}
+			}
+#endif
 		else if(!_buffLine)	{
 			_buffLine = new char[_buffLineLen];
+			Memory::Add(Memory::LINE, _buffLineLen);
 			memset(_buffLine, _delim, _buffLineLen);
 			_buffLineOffset = 0;
 		}
@@ -65,19 +947,30 @@ bool TxtFile::CreateBuffer(eBuff buffType)
 //	@cntRecLines: number of lines in a record
 //	@abortInvalid: true if invalid instance shold be completed by throwing exception
 //	@rintName: true if file name should be printed in exception's message
-TxtFile::TxtFile (const string& fName, eAction mode, BYTE cntRecLines, bool abortInvalid, bool printName) :
+//	@mapped: true if uncompressed regular file should be read in mapped mode
+//	@threadCnt: number of threads inflating multi-member gzip file
+//	@buffers: owner of reused read buffers, or NULL if buffers should be allocated
+TxtFile::TxtFile (const string& fName, eAction mode, BYTE cntRecLines,
+	bool abortInvalid, bool printName, bool mapped, BYTE threadCnt, TxtBuffers* buffers) :
 	_flag(0),
 	_cntRecLines(cntRecLines),
 	_buffLineLen(0)
 {
+	SetFlag(STDIN, mode == READ && FS::IsStdIn(fName));
+#ifndef _NO_ZLIB
+	SetFlag(ZIPPED, IsFlag(STDIN) || FS::HasGzipExt(fName));
+#else
 	SetFlag(ZIPPED, FS::HasGzipExt(fName));
+#endif
 	SetFlag(ABORTING, abortInvalid);
 	SetFlag(PRNAME, printName);
-	if( !SetBasic(fName, mode, NULL) )	return;
+	SetFlag(WRMODE, mode == WRITE);
+	if( !SetBasic(fName, mode, NULL, threadCnt) )	return;
+	if( mode == READ )	_buffers = buffers;
 	// set file's and buffer's sizes
-	_buffLen = NUMB_BLK * BASE_BLK_SIZE;
-	_fSize = FS::Size(fName.c_str());
-	if( _fSize == -1 )	_fSize = 0;		// new file
+	_buffLen = BuffLen;
+	if( IsFlag(STDIN) )	_fSize = LLONG(~ULLONG(0) >> 1);	// unknown length: read as big file
+	else if( (_fSize = FS::Size(fName.c_str())) == -1 )	_fSize = 0;		// new file
 #ifndef _NO_ZLIB
 	else if(IsZipped()) {				// existed file
 		LLONG size = FS::UncomressSize(fName.c_str());
@@ -92,20 +985,45 @@ TxtFile::TxtFile (const string& fName, eAction mode, BYTE cntRecLines, bool abor
 							// 2*_buffLen for writing or 3*_buffLen for reading by gzip
 	}
 #endif
-	if( _fSize && _fSize < _buffLen )
+#ifndef OS_Windows
+	if( mapped && mode == READ && CanMap() ) {
+		RaiseFlag(MAPPED);		// _buffLen is used as the length of mapped window
+		if( MapBlock(0) )
+			_linesLen = new UINT[cntRecLines];	// set lines buffer
+		return;
+	}
+#endif
+	if( _fSize && _fSize < _buffLen ) {
 		if( mode != WRITE )	
 			_buffLen = (ULONG)_fSize + 1;	// for reading
 		else if( _fSize * 2 < _buffLen )
 			_buffLen = (ULONG)_fSize * 2;	// for writing: increase small buffer for any case
-	
+	}
+#ifdef _MULTITHREAD
+	else if( _fSize && mode == READ ) {	// big file: read ahead by two half-blocks
+		RaiseFlag(READAHEAD);
+		_raBlkLen = _buffLen >>= 1;
+		_raHeadLen = min(UINT(RA_HEAD_SIZE), _raBlkLen);
+		_raInd = 0;
+		if( !CreateBuffer(BUFF_AHEAD) )	return;
+	}
+	if( !IsFlag(READAHEAD) )
+#endif
 	if( !CreateBuffer(BUFF_BASIC) )	return;
 
 #ifdef ZLIB_NEW
-	if( IsZipped() && gzbuffer( (gzFile)_stream, _buffLen) == -1 )
-	{ SetError(Err::FZ_MEM); return; }
+	if( IsZipped() && !IsFlag(UNZIPPER) && !IsFlag(ZIPPER) ) {
+		if( gzbuffer( (gzFile)_stream, _buffLen) == -1 )	{ SetError(Err::FZ_MEM); return; }
+		// zlib allocates the buffer of given size and the doubled one
+		RaiseFlag(ZBUFF);
+		Memory::Add(Memory::ZLIB, 3 * LLONG(_buffLen));
+	}
 #endif
 
 	if(mode != WRITE) {
+#ifdef _MULTITHREAD
+		if( IsFlag(READAHEAD) )		StartReadAhead();	// start reading first block
+#endif
 		if(ReadBlock(0) < 0)	return;		// read first block
 		_linesLen = new UINT[cntRecLines];	// set lines buffer
 	}
@@ -149,6 +1067,7 @@ TxtFile::TxtFile(const TxtFile& file, threadnumb threadNumb) :
 	// for mistiming block's writing to file as possible
 	_buffLen = BASE_BLK_SIZE * ((threadNumb<<2) + NUMB_BLK);
 	RaiseFlag(CLONE);
+	RaiseFlag(WRMODE);
 	RaiseFlag(MTHREAD);
 	file.RaiseFlag(MTHREAD);
 	CreateBuffer(BUFF_BASIC);
@@ -159,13 +1078,65 @@ TxtFile::TxtFile(const TxtFile& file, threadnumb threadNumb) :
 TxtFile::~TxtFile()
 {
 	if( _linesLen )						delete [] _linesLen;
-	if( _buff && !IsFlag(CONSTIT) )	delete [] _buff;
+	if( IsFlag(PROGRESS) )	ReportProgress(_readOffset);
+	if( _spill ) {
+		if( _buff == _spill && _basic )	{ _buff = _basic; _buffLen = _basicLen; }
+		delete [] _spill;
+		Memory::Add(Memory::SPILL, -LLONG(_spillLen));
+	}
+#ifndef OS_Windows
+	if( IsMapped() )	{
+		if( _map ) {
+			munmap(_map, _mapLen);
+			Memory::Add(Memory::MAPPED, -LLONG(_mapLen));
+		}
+	}
+	else
+#endif
+#ifdef _MULTITHREAD
+	if( IsFlag(READAHEAD) ) {
+		if( _raThread ) {
+			_raThread->WaitFor();
+			delete _raThread;
+		}
+		if( !_buffers )
+			for(BYTE i=0; i<2; i++)
+				if( _raBuff[i] ) {
+					delete [] _raBuff[i];
+					Memory::Add(Memory::READ_AHEAD, -LLONG(_raHeadLen + _raBlkLen + 1));
+				}
+	}
+	else
+#endif
+	if( _buff && !IsFlag(CONSTIT) && !_buffers ) {
+		delete [] _buff;
+		Memory::Add(IsFlag(WRMODE) ? Memory::WRITE : Memory::READ, -LLONG(_buffLen));
+	}
 	if( _buffLine )	{
 		//cout << "delete _buffLine\n";
 		delete [] _buffLine;
+		Memory::Add(Memory::LINE, -LLONG(_buffLineLen));
 	}
+	if( IsFlag(ZBUFF) )		// the length of basic buffer is varied in read-ahead mode
+		Memory::Add(Memory::ZLIB, -3 * LLONG(
+#ifdef _MULTITHREAD
+			IsFlag(READAHEAD) ? _raBlkLen :
+#endif
+			_buffLen));
 	if( _stream && !IsClone() )	{
-		int res = 
+		int res;
+#if defined _MULTITHREAD && !defined _NO_ZLIB
+		if( IsFlag(UNZIPPER) ) {
+			delete (Unzipper*)_stream;
+			res = 0;
+		}
+		else if( IsFlag(ZIPPER) ) {
+			res = !((Zipper*)_stream)->Close();
+			delete (Zipper*)_stream;
+		}
+		else
+#endif
+		res = 
 #ifndef _NO_ZLIB
 			IsZipped() ?
 				gzclose( (gzFile)_stream) :
@@ -175,38 +1146,231 @@ TxtFile::~TxtFile()
 	}
 }
 
+// Reads chars from file.
+//	@buff: buffer to read
+//	@len: number of chars to read
+//	return: number of readed chars or -1 if unsuccess reading
+int TxtFile::Read(char* buff, UINT len) const
+{
+#ifndef _NO_ZLIB
+	if( IsZipped() )
+#ifdef _MULTITHREAD
+		return IsFlag(UNZIPPER) ?
+			((Unzipper*)_stream)->Read(buff, len) :
+			gzread((gzFile)_stream, buff, len);
+#else
+		return gzread((gzFile)_stream, buff, len);
+#endif
+#endif
+	size_t readLen = fread(buff, sizeof(char), len, (FILE*)_stream);
+	if( readLen != len && (!feof((FILE*)_stream) || ferror((FILE*)_stream)) )
+		return -1;
+	return int(readLen);
+}
+
 // Reads next block.
 //	@offset: shift of start reading position
 //	return: 1 if file is not finished; 0 if it is finished; -1 if unsuccess reading
 int TxtFile::ReadBlock(const UINT offset)
 {
-	size_t readLen;
-#ifndef _NO_ZLIB
-	if( IsZipped() ) {
-		int len = gzread((gzFile)_stream, _buff + offset, _buffLen - offset);
-		if(len < 0) { SetError(Err::F_READ); return -1; }
-		readLen = len;
+	const ULLONG readOffset = _readOffset;	// the chars read before are consumed
+	int readLen;
+	const Stages::eStage stage = Stages::Switch(Stages::READ);
+	Trace::Span span("block", "read block");
+#ifdef _MULTITHREAD
+	if( IsFlag(READAHEAD) ) {
+		_raThread->WaitFor();
+		delete _raThread;
+		_raThread = NULL;
+		readLen = _raLen;
+		if( offset > _raHeadLen ) {
+			// join untreated rest of record and the block read ahead in spill buffer
+			if( !Spill(offset + _raBlkLen + 1, offset) )	{ Stages::Switch(stage); return -1; }
+			if( readLen > 0 )	memcpy(_buff + offset, _raBuff[_raInd] + _raHeadLen, readLen);
+		}
+		else {
+			// place untreated rest of record just before the block read ahead
+			char* buff = _raBuff[_raInd] + _raHeadLen - offset;
+			if( offset )	memcpy(buff, _buff, offset);
+			_buff = buff;
+		}
+		_buffLen = offset + _raBlkLen;
+		_raInd = !_raInd;
+		if( readLen >= 0 )	CountRead(readLen);
+		if( readLen == int(_raBlkLen) )	StartReadAhead();	// file is not finished
 	}
 	else
 #endif
 	{
-		readLen = fread(_buff + offset, sizeof(char), _buffLen - offset, (FILE*)_stream);
-		if(readLen != _buffLen - offset && !feof((FILE*)_stream) )
-		{ SetError(Err::F_READ); return -1; }
+		if( offset == _buffLen ) {		// record fills the whole buffer: continue it in spill buffer
+			if( _buff != _spill )	{ _basic = _buff; _basicLen = _buffLen; }
+			if( !Spill(offset << 1, offset) )	{ Stages::Switch(stage); return -1; }
+			_buffLen = _spillLen;
+		}
+		else if( _buff == _spill && offset <= _basicLen >> 1 ) {	// records fit basic buffer again
+			memcpy(_basic, _buff, offset);
+			_buff = _basic;
+			_buffLen = _basicLen;
+		}
+		if( (readLen = Read(_buff + offset, _buffLen - offset)) >= 0 )
+			CountRead(readLen);
 	}
-	
+	Stages::Switch(stage);
+	if( readLen < 0 )	{ SetError(Err::F_READ); return -1; }
 	_readingLen = readLen + offset;
-//#ifdef ZLIB_OLD
-	//if( _readTotal + _readingLen > _fSize )
-	//	_readingLen = _fSize - _readTotal;
-	//_readTotal += _readingLen;
-//#endif
-	if( _readingLen != _buffLen && !IsZipped() && ferror((FILE*)_stream) )
-	{ SetError(Err::F_READ); return -1; }
 	_currRecPos = 0;
+	if( IsFlag(PROGRESS) )	ReportProgress(readOffset);
 	return _readingLen == 0 ? 0 : 1;
 }
 
+// Reports the chars consumed and records read since the last report to Progress
+//	@offset: offset in file before the unconsumed chars
+void TxtFile::ReportProgress(ULLONG offset)
+{
+	if( offset < _progOffset )	offset = _progOffset;
+	Progress::Add(offset - _progOffset, _cntRecords - _progRecords);
+	_progOffset = offset;
+	_progRecords = _cntRecords;
+}
+
+// Starts reporting the read chars and records to Progress, if it is enabled
+void TxtFile::TrackProgress()
+{
+	if( !Progress::Enabled )	return;
+	LLONG len = IsFlag(STDIN) ? -1 : FS::Size(_fName.c_str());
+#if !defined ZLIB_NEW && !defined _NO_ZLIB
+	if( IsZipped() && !IsFlag(UNZIPPER) )	len = -1;	// compressed offset is unknown
+#endif
+	Progress::AddInput(len);
+	RaiseFlag(PROGRESS);
+	ReportProgress(0);
+}
+
+// Makes the spill buffer current, grown if necessary, and moves the untreated rest of record to it.
+//	@len: required length of buffer
+//	@restLen: length of untreated rest of record at the beginning of current buffer
+//	return: true if success
+bool TxtFile::Spill(UINT len, UINT restLen)
+{
+	if( _spillLen < len ) {
+		char* spill;
+		if( len < (_spillLen << 1) )	len = _spillLen << 1;	// avoid frequent growing
+		try { spill = new char[len]; }
+		catch(const bad_alloc&)	{ SetError(Err::F_MEM); return false; }
+		Memory::Add(Memory::SPILL, len);
+		memcpy(spill, _buff, restLen);
+		if( _spill ) {
+			delete [] _spill;
+			Memory::Add(Memory::SPILL, -LLONG(_spillLen));
+		}
+		_spill = spill;
+		_spillLen = len;
+	}
+	else if( _buff != _spill )
+		memcpy(_spill, _buff, restLen);
+	_buff = _spill;
+	return true;
+}
+
+// Adds the number of read chars and updates the offset in file.
+// Should be called while file is not read ahead.
+//	@len: number of read chars
+void TxtFile::CountRead(UINT len)
+{
+	_readTotal += len;
+#ifndef _NO_ZLIB
+	if( IsZipped() ) {
+#if defined _MULTITHREAD
+		if( IsFlag(UNZIPPER) ) {
+			_readOffset = ((Unzipper*)_stream)->InLength();
+			return;
+		}
+#endif
+#ifdef ZLIB_NEW
+		const LLONG offset = gzoffset((gzFile)_stream);
+		if( offset >= 0 ) {				// offset of pipe is unknown
+			_readOffset = offset;
+			return;
+		}
+#endif
+	}
+#endif
+	_readOffset = _readTotal;
+}
+
+#ifdef _MULTITHREAD
+// Starts reading the next block ahead by separate thread.
+void TxtFile::StartReadAhead()
+{
+	_raThread = new Thread(ReadAhead, this);
+}
+
+// Reads the next block ahead; thread procedure
+//	@file: this instance
+retThreadValType
+#ifdef OS_Windows
+	__stdcall
+#endif
+	TxtFile::ReadAhead(void* arg)
+{
+	TxtFile* file = (TxtFile*)arg;
+	Trace::Attach("read-ahead", file);
+	Trace::Span span("block", "read ahead");
+	file->_raLen = file->Read(file->_raBuff[file->_raInd] + file->_raHeadLen, file->_raBlkLen);
+	return retThreadValTrue;
+}
+#endif
+
+#ifndef OS_Windows
+// Returns true if file can be read in mapped mode.
+// It should be uncompressed regular file, and the last line not ended by EOL
+// should be closed by zero tail of the last mapped page.
+bool TxtFile::CanMap() const
+{
+	struct_stat64 st;
+	int fd = fileno((FILE*)_stream);
+
+	if( IsZipped() || IsFlag(STDIN) || !_fSize || fstat(fd, &st) || !S_ISREG(st.st_mode) )
+		return false;
+	if( _fSize % sysconf(_SC_PAGESIZE) == 0 ) {		// no zero tail
+		char c;
+		if( pread(fd, &c, 1, _fSize - 1) != 1 || c != EOL )	return false;
+	}
+	return true;
+}
+
+// Maps next window of file in mapped mode.
+//	@offset: shift of start mapping position relative to the current buffer
+//	return: true if success
+bool TxtFile::MapBlock(const UINT offset)
+{
+	LLONG pos = _buffPos + offset;							// file offset of the new buffer
+	LLONG mapPos = pos & ~LLONG(sysconf(_SC_PAGESIZE) - 1);	// window offset aligned to page
+
+	if( _map ) {
+		if( !offset )	_buffLen <<= 1;		// record fills the whole window: enlarge it
+		munmap(_map, _mapLen);
+		Memory::Add(Memory::MAPPED, -LLONG(_mapLen));
+	}
+	_mapLen = size_t(min(LLONG(_buffLen), _fSize - mapPos));
+	_map = mmap(NULL, _mapLen, PROT_READ, MAP_PRIVATE, fileno((FILE*)_stream), mapPos);
+	if( _map == MAP_FAILED ) {
+		_map = NULL;
+		SetError(Err::F_READ);
+		return false;
+	}
+	Memory::Add(Memory::MAPPED, _mapLen);
+	madvise(_map, _mapLen, MADV_SEQUENTIAL);
+	_buff = (char*)_map + (pos - mapPos);
+	_buffPos = pos;
+	_readingLen = UINT(mapPos + _mapLen - pos);
+	_readTotal = _readOffset = mapPos + _mapLen;
+	_currRecPos = 0;
+	if( IsFlag(PROGRESS) )	ReportProgress(_buffPos);
+	return true;
+}
+#endif
+
 // Sets _currLinePos to the beginning of next non-empty line in _buff
 //	@counterN: if not NULL, adds to counterN the number of 'N' in a record. Used in Fa() only.
 //	@posTab: if not NULL, sets TABs positions in line to this array
@@ -221,13 +1385,29 @@ char* TxtFile::GetRecord(chrlen* const counterN, short* const posTab, BYTE cntTa
 	chrlen cntN = 0;				// local counter of 'N'
 	BYTE indTab = 1;				// index of TAB position in @posTab
 	char c;
+#ifdef SIMD_LEN
+	UINT vecPos = 0,				// position of the last compared chars
+		 vecEnd = 0,				// position after the last compared chars
+		 mask = 0;					// bit mask of EOL and TAB in the last compared chars
+#endif
 
 	_recLen = 0;
 	for(BYTE r=0; r<_cntRecLines; r++)
 		for(i=currLinePos;; i++)	{
 			if( i >= _readingLen ) {			// check for the next block
+#ifndef OS_Windows
+				if( IsMapped() ) {
+					if( _buffPos + _readingLen == _fSize )	// final window
+						if( i == currLinePos )		// current line is empty
+							return ReadingEnded();	// normal completion
+						else						// current line is not ended by EOL:
+							goto A;					// it is closed by zero tail of the mapped page
+				}
+				else
+#endif
 				if( _readingLen != _buffLen )	// final block
-					if( i == _buffLen			// current line is not ended by EOL
+					if( !i						// block is empty: possible for standard input
+					|| i == _buffLen			// current line is not ended by EOL
 					|| _buff[i-1] == EOL		// current line which is ended by EOL
 					|| _buff[i-1] == '\0'	)	// EOL in the current line has been replaced by 0 in previous call TabFile::GetLine()
 						return ReadingEnded();	// normal completion
@@ -236,20 +1416,45 @@ char* TxtFile::GetRecord(chrlen* const counterN, short* const posTab, BYTE cntTa
 							_buff[i] = '\0';	// close current line
 						goto A;
 					}
-				// jump to the next block
-				if( !currLinePos ) {			// this block is totally unreaded
-					SetError(Err::F_BIGLINE);
-					return ReadingEnded();
+				// jump to the next block; the record filling the whole block is continued in bigger buffer
+#ifndef OS_Windows
+				if( IsMapped() ) {
+					// map window beginning from untreated rest of record
+					if( !MapBlock(_currRecPos) )
+						return ReadingEnded();
+				}
+				else
+#endif
+				{
+					// length of untreated rest of record
+					UINT restLen = _readingLen - _currRecPos - cntEmpty;
+					// move untreated rest to the beginning of buffer; if restLen=0, skip moving
+					memmove(_buff, _buff + _currRecPos, restLen);
+					if( !ReadBlock(restLen) )
+						return ReadingEnded();	// record was finished exactly by previous ReadBlock()
 				}
-				// length of untreated rest of record
-				UINT restLen = _readingLen - _currRecPos - cntEmpty;
-				// move untreated rest to the beginning of buffer; if restLen=0, skip moving
-				memmove(_buff, _buff + _currRecPos, restLen);
-				if( !ReadBlock(restLen) )
-					return ReadingEnded();	// record was finished exactly by previous ReadBlock()
 				indTab = 1;
 				cntN = currLinePos = cntEmpty = i = _recLen = r = 0;
+#ifdef SIMD_LEN
+				vecEnd = 0;
+#endif
+			}
+#ifdef SIMD_LEN
+			if( !counterN ) {				// jump to the next EOL or TAB
+				if( i >= vecEnd && i + SIMD_LEN <= _readingLen ) {
+					mask = SpecCharsMask(_buff + i);
+					vecEnd = (vecPos = i) + SIMD_LEN;
+				}
+				if( i < vecEnd ) {
+					mask &= UINT(-1) << (i - vecPos);	// skip treated chars
+					if( !mask ) {
+						i = vecEnd - 1;
+						continue;
+					}
+					i = vecPos + LowBitInd(mask);
+				}
 			}
+#endif
 			c = _buff[i];
 			if( counterN && c==cN )
 				cntN++;
@@ -395,6 +1600,10 @@ void TxtFile::Write() const
 	//cout << "Write " << _fName << "\tsize = " << _currRecPos << endl;
 	int res = 
 #ifndef _NO_ZLIB
+#ifdef _MULTITHREAD
+		IsFlag(ZIPPER) ?
+		(((Zipper*)_stream)->Write(_buff, _currRecPos) ? _currRecPos : 0) :
+#endif
 		IsZipped() ?
 		gzwrite((gzFile)_stream, _buff, _currRecPos) :
 #endif
@@ -606,8 +1815,10 @@ void Regions::Print () const
 //	return: true if field is valid
 bool TabFile::IsFieldValid	(BYTE ind) const
 {
+	char c;
 	if(_fieldPos[ind] == vUNDEF		// vUNDEF was set in buff if there was no such field in the line
-	|| !SField(ind)[0]) {			// empty string was set if the line was ended by TAB (empty field)
+	|| !(c = SField(ind)[0])		// empty string was set if the line was ended by TAB (empty field)
+	|| c == TAB || c == EOL) {		// empty field in mapped mode
 		if(ind < _params.MinFieldCnt)
 			ThrowLineExcept(Err::TF_FIELD);
 		return false;
@@ -615,6 +1826,112 @@ bool TabFile::IsFieldValid	(BYTE ind) const
 	return true;
 }
 
+// Parses unsigned decimal integer.
+//	@s: chars to parse
+//	@end: pointer after the last readable char
+//	@val: parsed value
+//	return: pointer to the char after the last digit, or NULL if there are no digits or value exceeds UINT
+const char* TabFile::ParseUInt(const char* s, const char* end, UINT& val)
+{
+	const char* start = s;
+	ULLONG v = 0;
+	BYTE d;
+
+#if defined __GNUC__ && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	if( s + sizeof(ULLONG) <= end ) {	// SWAR: up to 8 digits at once
+		ULLONG t;
+		memcpy(&t, s, sizeof(ULLONG));
+		t ^= 0x3030303030303030ULL;		// digits become 0-9 bytes
+		// non-zero high nibble marks non-digit; carry after non-digit byte does not matter
+		const ULLONG mask = (t | (t + 0x0606060606060606ULL)) & 0xF0F0F0F0F0F0F0F0ULL;
+		const BYTE cnt = mask ? BYTE(__builtin_ctzll(mask) >> 3) : sizeof(ULLONG);	// number of digits
+		if( !cnt )	return NULL;
+		// align digits to the end with leading zeros and combine them by pairs, quads and octets
+		t <<= (sizeof(ULLONG) - cnt) << 3;
+		t = (t * 10 + (t >> 8)) & 0x00FF00FF00FF00FFULL;
+		t = (t * 100 + (t >> 16)) & 0x0000FFFF0000FFFFULL;
+		v = (t * 10000 + (t >> 32)) & 0xFFFFFFFFULL;
+		s += cnt;
+		if( cnt < sizeof(ULLONG) ) {
+			val = UINT(v);
+			return s;
+		}
+	}
+#endif
+	for(; (d = BYTE(*s - '0')) <= 9; s++)
+		if( (v = v * 10 + d) > UINT_MAX )	return NULL;
+	if( s == start )	return NULL;
+	val = UINT(v);
+	return s;
+}
+
+// Checks the end of parsed integer field and throws exception if it is invalid.
+//	@end: pointer to the char after the last digit, or NULL if parsing is failed
+//	return: @end
+const char* TabFile::CheckNumbEnd(const char* end) const
+{
+	if( !end || (*end && *end != TAB && *end != EOL && *end != CR && *end != BLANK) )
+		ThrowLineExcept(Err::TF_NUMB);
+	return end;
+}
+
+// Reads integer by field's index from current line.
+// Faster than IntField(): does not skip blanks and does not depend on locale.
+//	@fInd: field index
+//	@val: returned value
+//	return: pointer to the char after the value, or NULL if field is absent and not obligatory
+//	Exception: file_error if field is not a valid integer
+const char* TabFile::IntField(BYTE fInd, int& val) const
+{
+	if( !IsFieldValid(fInd) )	return NULL;
+	const char* s = SField(fInd);
+	const bool neg = *s == '-';
+	UINT v;
+	s = CheckNumbEnd(ParseUInt(s + neg, BuffEnd(), v));
+	if( v > UINT(INT_MAX) + neg )	ThrowLineExcept(Err::TF_NUMB);
+	val = neg && v ? -int(v - 1) - 1 : int(v);	// avoid overflow on INT_MIN
+	return s;
+}
+
+// Decodes the following data lines "position TAB value" into arrays.
+// Decoding is stopped by a non-data line, the end of file or full arrays.
+// Lines beginning with digit are data ones; lines that are not just two decimal integers
+// are read and checked as by GetLine() with UIntField() and IntField().
+//	@pos: array of positions
+//	@vals: array of values
+//	@maxCnt: capacity of arrays
+//	@line: returned non-data line that stopped decoding and set as current, or NULL
+//	return: number of decoded lines; if it is less than @maxCnt and @line is NULL, file is ended
+//	Exception: file_error if data line is invalid
+ULONG TabFile::GetData(chrlen* pos, int* vals, ULONG maxCnt, const char*& line)
+{
+	const bool inPlace = !_params.LineSpec;	// true if lines can be decoded in the buffer
+	const char *s, *eol;
+	ULONG cnt = 0;
+	UINT v;
+	bool neg;
+
+	for(line = NULL; cnt < maxCnt; cnt++) {
+		// fast path: the line in current block is decoded without tokenizing
+		if( inPlace && (s = PeekLine(eol)) != NULL && isdigit(*s)
+		&& (s = ParseUInt(s, BuffEnd(), pos[cnt])) != NULL && *s == TAB ) {
+			neg = *++s == '-';
+			if( (s = ParseUInt(s + neg, BuffEnd(), v)) != NULL && v <= UINT(INT_MAX) + neg
+			&& (s == eol || (*s == CR && s + 1 == eol)) ) {
+				vals[cnt] = neg && v ? -int(v - 1) - 1 : int(v);
+				AcceptLine(eol);
+				continue;
+			}
+		}
+		// irregular line, or line crossing the block
+		if( (s = GetLine()) == NULL )	break;
+		if( !isdigit(*s) )	{ line = s; break; }
+		UIntField(0, pos[cnt]);
+		IntField(1, vals[cnt]);
+	}
+	return cnt;
+}
+
 // Initializes new instance.
 //	@mode: action mode (read, write, all)
 void TabFile::Init(eAction mode)
@@ -679,6 +1996,7 @@ const char*	TabFile::GetLine()
 				}
 
 		_fieldPos[0] = currPos;		// set start position of first field
+		if( IsMapped() )	return _currLine = currLine;	// read-only buffer
 		// replace TABs by 0
 		for(BYTE i=1; i<_params.MaxFieldCnt; i++) {
 			//if( (currPos=_fieldPos[i]) == vUNDEF ) {	// last position may be 0 if numbers of TABs in line is less than number of fields
@@ -705,6 +2023,264 @@ const char*	TabFile::GetLine()
 
 /************************ end of class TabFile ************************/
 
+#ifdef _WIGREG
+
+#define TRACK_MAGIC			"WGRB"	// signature of binary track
+#define TRACK_MAGIC_LEN		4
+#define TRACK_VERSION		1
+#define TRACK_BLOCK_SIZE	4096	// maximum number of records in block
+#define TRACK_BLOCK_HEAD	(4 * sizeof(UINT))	// length of block header
+#define TRACK_TAIL_SIZE		(2 * sizeof(UINT) + sizeof(ULLONG) + TRACK_MAGIC_LEN)	// length of footer's tail
+
+/************************ class TrackWriter ************************/
+
+// Adds varint
+//	@col: column
+//	@val: value
+inline void Encode(vector<BYTE>& col, UINT val)
+{
+	for(; val >= 0x80; val >>= 7)
+		col.push_back(BYTE(val | 0x80));
+	col.push_back(BYTE(val));
+}
+
+// Adds zigzag varint of signed difference
+//	@col: column
+//	@val: difference
+inline void EncodeGap(vector<BYTE>& col, int val)
+{
+	Encode(col, (UINT(val) << 1) ^ UINT(val >> 31));
+}
+
+// Creates new instance
+//	@fName: file name
+TrackWriter::TrackWriter(const char* fName) : _offset(0), _error(false)
+{
+	if( !(_file = fopen(fName, "wb")) )		Err(Err::F_OPEN, fName).Throw();
+	const UINT version = TRACK_VERSION;
+	Write(TRACK_MAGIC, TRACK_MAGIC_LEN);
+	Write(&version, sizeof(UINT));
+	_recs.reserve(TRACK_BLOCK_SIZE);
+}
+
+// Writes data to file
+void TrackWriter::Write(const void* data, size_t len)
+{
+	if( fwrite(data, 1, len, _file) != len )	_error = true;
+	_offset += len;
+}
+
+// Encodes and writes current block
+void TrackWriter::WriteBlock()
+{
+	if( _recs.empty() )		return;
+	TrackRecord prev = { 0, 0, 0 };
+	UINT head[4];
+
+	for(BYTE i=0; i<3; i++)		_cols[i].clear();
+	for(vector<TrackRecord>::const_iterator it=_recs.begin(); it!=_recs.end(); it++) {
+		EncodeGap(_cols[0], int(it->Pos - prev.Pos - prev.Span));
+		EncodeGap(_cols[1], int(it->Span - prev.Span));
+		Encode(_cols[2], UINT(it->Val));
+		prev = *it;
+	}
+	head[0] = UINT(_recs.size());
+	for(BYTE i=0; i<3; i++)		head[i+1] = UINT(_cols[i].size());
+	_blocks.push_back(_offset);
+	Write(head, TRACK_BLOCK_HEAD);
+	for(BYTE i=0; i<3; i++)		Write(&_cols[i][0], _cols[i].size());
+	_chroms.back().RecCnt += _recs.size();
+	_chroms.back().BlockCnt++;
+	_recs.clear();
+}
+
+// Sets current chromosome
+//	@name: chromosome's name
+void TrackWriter::SetChrom(const string& name)
+{
+	WriteBlock();
+	TrackChrom chrom = { name, 0, UINT(_blocks.size()), 0 };
+	_chroms.push_back(chrom);
+}
+
+// Adds records of current chromosome
+//	@recs: records
+//	@cnt: number of records
+void TrackWriter::Add(const TrackRecord* recs, size_t cnt)
+{
+	for(const TrackRecord* rec = recs; rec < recs + cnt; rec++) {
+		_recs.push_back(*rec);
+		if( _recs.size() == TRACK_BLOCK_SIZE )	WriteBlock();
+	}
+}
+
+// Writes the rest of records and footer, and closes file
+//	return: true if successful
+bool TrackWriter::Close()
+{
+	if( !_file )	return !_error;
+	WriteBlock();
+	const ULLONG dirOffset = _offset;
+	for(vector<TrackChrom>::const_iterator it=_chroms.begin(); it!=_chroms.end(); it++) {
+		const USHORT len = USHORT(it->Name.length());
+		Write(&len, sizeof(USHORT));
+		Write(it->Name.c_str(), len);
+		Write(&it->RecCnt, sizeof(ULLONG));
+		Write(&it->FirstBlock, sizeof(UINT));
+		Write(&it->BlockCnt, sizeof(UINT));
+	}
+	if( _blocks.size() )
+		Write(&_blocks[0], _blocks.size() * sizeof(ULLONG));
+	const UINT cnts[] = { UINT(_chroms.size()), UINT(_blocks.size()) };
+	Write(cnts, sizeof(cnts));
+	Write(&dirOffset, sizeof(ULLONG));
+	Write(TRACK_MAGIC, TRACK_MAGIC_LEN);
+	if( fclose(_file) )		_error = true;
+	_file = NULL;
+	return !_error;
+}
+
+/************************ end of class TrackWriter ************************/
+
+/************************ class TrackReader ************************/
+
+// Returns true if file is binary track
+//	@fName: file name
+bool TrackReader::IsTrack(const char* fName)
+{
+	char magic[TRACK_MAGIC_LEN];
+	FILE* file = fopen(fName, "rb");
+	if( !file )		return false;
+	const bool res = fread(magic, 1, TRACK_MAGIC_LEN, file) == TRACK_MAGIC_LEN
+		&& !memcmp(magic, TRACK_MAGIC, TRACK_MAGIC_LEN);
+	fclose(file);
+	return res;
+}
+
+// Opens binary track
+//	@fName: file name
+TrackReader::TrackReader(const char* fName) :
+	_fName(fName), _data(NULL), _len(0), _block(0), _endBlock(0), _recCnt(0)
+{
+	const LLONG len = FS::Size(fName);
+	if( len < LLONG(TRACK_MAGIC_LEN + sizeof(UINT) + TRACK_TAIL_SIZE) )
+		Err(Err::TR_INVALID, fName).Throw();
+	_len = size_t(len);
+#ifdef OS_Windows
+	FILE* file = fopen(fName, "rb");
+	if( !file )		Err(Err::F_OPEN, fName).Throw();
+	BYTE* data = new BYTE[_len];
+	const size_t readLen = fread(data, 1, _len, file);
+	fclose(file);
+	_data = data;
+	if( readLen != _len )	{ Release();	Err(Err::F_READ, fName).Throw(); }
+#else
+	const int fd = open(fName, O_RDONLY);
+	if( fd < 0 )	Err(Err::F_OPEN, fName).Throw();
+	void* map = mmap(NULL, _len, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if( map == MAP_FAILED )		Err(Err::F_READ, fName).Throw();
+	_data = (const BYTE*)map;
+#endif
+	if( !ReadFooter() )		{ Release();	Err(Err::TR_INVALID, fName).Throw(); }
+}
+
+// Releases file content
+void TrackReader::Release()
+{
+	if( !_data )	return;
+#ifdef OS_Windows
+	delete [] _data;
+#else
+	munmap((void*)_data, _len);
+#endif
+	_data = NULL;
+}
+
+// Reads chromosome directory and block offsets
+//	return: false if footer is invalid
+bool TrackReader::ReadFooter()
+{
+	const BYTE* p = _data + _len - TRACK_TAIL_SIZE;
+	UINT chromCnt, blockCnt;
+
+	// footer's tail
+	memcpy(&chromCnt, p, sizeof(UINT));		p += sizeof(UINT);
+	memcpy(&blockCnt, p, sizeof(UINT));		p += sizeof(UINT);
+	memcpy(&_dirOffset, p, sizeof(ULLONG));	p += sizeof(ULLONG);
+	if( memcmp(p, TRACK_MAGIC, TRACK_MAGIC_LEN)
+	|| ULLONG(blockCnt) * sizeof(ULLONG) > _len - TRACK_TAIL_SIZE
+	|| _dirOffset > _len - TRACK_TAIL_SIZE - blockCnt * sizeof(ULLONG) )
+		return false;
+	// chromosome directory
+	const BYTE* end = _data + _len - TRACK_TAIL_SIZE - blockCnt * sizeof(ULLONG);
+	p = _data + _dirOffset;
+	_chroms.resize(chromCnt);
+	for(vector<TrackChrom>::iterator it=_chroms.begin(); it!=_chroms.end(); it++) {
+		USHORT len;
+		if( p + sizeof(USHORT) > end )	return false;
+		memcpy(&len, p, sizeof(USHORT));	p += sizeof(USHORT);
+		if( p + len + sizeof(ULLONG) + 2 * sizeof(UINT) > end )		return false;
+		it->Name.assign((const char*)p, len);		p += len;
+		memcpy(&it->RecCnt, p, sizeof(ULLONG));		p += sizeof(ULLONG);
+		memcpy(&it->FirstBlock, p, sizeof(UINT));	p += sizeof(UINT);
+		memcpy(&it->BlockCnt, p, sizeof(UINT));		p += sizeof(UINT);
+		if( ULLONG(it->FirstBlock) + it->BlockCnt > blockCnt )	return false;
+	}
+	// block offsets
+	_blocks.resize(blockCnt);
+	if( blockCnt )	memcpy(&_blocks[0], end, blockCnt * sizeof(ULLONG));
+	for(vector<ULLONG>::const_iterator it=_blocks.begin(); it!=_blocks.end(); it++)
+		if( *it + TRACK_BLOCK_HEAD > _dirOffset )	return false;
+	return true;
+}
+
+
+// Starts iteration through chromosome's records
+//	@ind: index of chromosome
+void TrackReader::SetChrom(size_t ind)
+{
+	_block = _chroms[ind].FirstBlock;
+	_endBlock = _block + _chroms[ind].BlockCnt;
+	_recCnt = 0;
+}
+
+// Sets next block of current chromosome
+//	return: false if there are no more blocks
+bool TrackReader::NextBlock()
+{
+	for(; _block < _endBlock; _block++) {
+		const BYTE* p = _data + _blocks[_block];
+		UINT head[4];
+		memcpy(head, p, TRACK_BLOCK_HEAD);
+		p += TRACK_BLOCK_HEAD;
+		// each record takes at least one byte in each column
+		if( ULLONG(p - _data) + head[1] + head[2] + head[3] > _dirOffset
+		|| head[0] > head[1] || head[0] > head[2] || head[0] > head[3] )
+			Invalid();
+		for(BYTE i=0; i<3; i++) {
+			_cols[i] = p;
+			_colEnds[i] = p += head[i+1];
+		}
+		_rec.Pos = _rec.Span = 0;
+		if( (_recCnt = head[0]) != 0 ) {
+			_block++;
+			return true;
+		}
+	}
+	return false;
+}
+
+// Throws exception of invalid format
+void TrackReader::Invalid() const
+{
+	Err(Err::TR_INVALID, _fName.c_str()).Throw();
+}
+
+/************************ end of class TrackReader ************************/
+
+#endif	// _WIGREG
+
 #if !defined _WIGREG
 
 /************************ class FaFile ************************/
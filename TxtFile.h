@@ -7,26 +7,322 @@
 // Otherwise the behaviour is unpredictable.
 #define NUMB_BLK 32
 #define BASE_BLK_SIZE (2 * 1024 * 1024)	// basic block 2 Mb
+// Maximal room before each read-ahead block to place the untreated rest of record;
+// the longer rest is placed in the spill buffer.
+#define RA_HEAD_SIZE BASE_BLK_SIZE
 
 typedef short rowlen;	// type: length of row in TxtFile
 
+// Vectorized search for EOL and TAB in TxtFile::GetRecord():
+// AVX2 if compiler targets it (f.e. by -mavx2 option), otherwise SSE2
+#if defined __AVX2__
+	#include <immintrin.h>
+	#define SIMD_LEN	32		// number of chars compared at once
+#elif defined __SSE2__ || defined _M_X64
+	#include <emmintrin.h>
+	#define SIMD_LEN	16		// number of chars compared at once
+#endif
+
+#ifdef SIMD_LEN
+// Returns bit mask of EOL and TAB positions in SIMD_LEN chars
+//	@s: chars to search
+inline UINT SpecCharsMask(const char* s)
+{
+#ifdef __AVX2__
+	const __m256i v = _mm256_loadu_si256((const __m256i*)s);
+	return UINT(_mm256_movemask_epi8(_mm256_or_si256(
+		_mm256_cmpeq_epi8(v, _mm256_set1_epi8(EOL)),
+		_mm256_cmpeq_epi8(v, _mm256_set1_epi8(TAB)) )));
+#else
+	const __m128i v = _mm_loadu_si128((const __m128i*)s);
+	return UINT(_mm_movemask_epi8(_mm_or_si128(
+		_mm_cmpeq_epi8(v, _mm_set1_epi8(EOL)),
+		_mm_cmpeq_epi8(v, _mm_set1_epi8(TAB)) )));
+#endif
+}
+
+// Returns index of the lowest set bit in non-zero mask
+inline BYTE LowBitInd(UINT mask)
+{
+#ifdef OS_Windows
+	unsigned long ind;
+	_BitScanForward(&ind, mask);
+	return BYTE(ind);
+#else
+	return BYTE(__builtin_ctz(mask));
+#endif
+}
+#endif	// SIMD_LEN
+
+#if defined _MULTITHREAD && !defined _NO_ZLIB
+#define UNZIP_CHUNK_SIZE BASE_BLK_SIZE	// compressed chunk inflated by one thread
+#define UNZIP_WINDOW	32768			// length of deflate window
+#define BGZF_BLOCK_SIZE	0xff00			// maximum length of BGZF member's content
+#define ZIP_PART_SIZE	(32 * BGZF_BLOCK_SIZE)	// uncompressed part deflated by one thread
+
+// 'Unzipper' inflates gzip file by few threads.
+// Compressed batch is split into chunks, each starting at the supposed beginning of member
+// or of deflate block inside member. Member is found by the chain of BGZF member lengths
+// or searched speculatively by gzip magic; block is searched bit by bit as a valid header
+// of dynamic Huffman block, so ordinary single-member gzip is split too.
+// Chunks are inflated in parallel, then accepted in order while each of them starts exactly
+// where the previous one ended. Inflating is resumed from the end of the last accepted chunk,
+// so false beginnings cost only the repeated work.
+// Chunk beginning inside member is inflated twice with two marking windows, so each char
+// copied from the unknown window gets a pair of different values encoding its window position,
+// while literal char gets the same value. As soon as the last window length of data
+// contains no marks, the rest of data does not depend on the window and is inflated once.
+// On acceptance the marks are replaced by chars of the true window, which is the end
+// of the previous chunk, so the serial back-patch is linear and cheap.
+// Members' CRC32 and length are checked by combining CRC32 of their parts in chunks.
+class Unzipper
+{
+private:
+	// 'Segment' is a part of chunk's data belonging to one member
+	struct Segment {
+		size_t	End;		// data offset after the segment
+		ULONG	Crc;		// CRC32 of segment; for the first segment, of data after chunk's CleanLen
+		ULONG	MemberCrc;	// CRC32 saved in member's footer
+		ULONG	MemberLen;	// length of member's content saved in member's footer
+		bool	Closed;		// true if member is ended by the segment
+	};
+
+	// 'Chunk' is a part of compressed batch inflated by one thread
+	struct Chunk {
+		const Unzipper* Owner;
+		size_t	Start;		// batch bit offset of the first member or block
+		size_t	Limit;		// batch bit offset of the next chunk
+		size_t	End;		// batch bit offset after the last inflated member or block
+		bool	InMember;	// true if chunk begins by block inside member
+		bool	EndInMember;// true if chunk ends by block inside member
+		vector<char> Data;	// inflated content
+		vector<char> Marks;	// the beginning of content inflated with the second marking window
+		size_t	DataLen;	// length of inflated content
+		size_t	CleanLen;	// length of the beginning of data depending on the window
+		vector<Segment> Segments;	// parts of data belonging to members
+		bool	Error;		// true if inflating is stopped by invalid data
+	};
+
+	FILE*	_file;
+	vector<char>	_batch;		// compressed batch
+	size_t	_batchLen;			// number of chars in batch
+	size_t	_consumed;			// batch bit offset after the last accepted member or block
+	bool	_inMember;			// true if the last accepted chunk is ended inside member
+	vector<Chunk>	_chunks;
+	BYTE	_chunkCnt;			// number of accepted chunks
+	BYTE	_chunkInd;			// index of chunk to read
+	size_t	_dataPos;			// position in chunk's data to read
+	ULLONG	_dataLen;			// total length of inflated data
+	ULLONG	_inLen;				// total length of read compressed data
+	vector<char>	_window;	// the last inflated data
+	size_t	_windowLen;			// length of the last inflated data
+	ULONG	_memberCrc;			// CRC32 of accepted content of current member
+	ULLONG	_memberLen;			// length of accepted content of current member
+	bool	_eof;				// true if file is read to the end
+
+	// Searches for the beginning of chunk; thread procedure
+	//	@chunk: chunk whose Start and Limit keep the batch range to search in bytes
+	static retThreadValType
+#ifdef OS_Windows
+		__stdcall
+#endif
+		Search(void* chunk);
+
+	// Inflates members and blocks of chunk; thread procedure
+	//	@chunk: chunk to inflate
+	static retThreadValType
+#ifdef OS_Windows
+		__stdcall
+#endif
+		Inflate(void* chunk);
+
+	// Returns the length of BGZF member, or 0 if it is not BGZF member
+	//	@c: supposed beginning of member
+	//	@len: number of available chars
+	static size_t BgzfLen(const char* c, size_t len);
+
+	// Returns true if member supposedly begins by given chars
+	//	@c: supposed beginning of member
+	//	@len: number of available chars
+	static bool IsMember(const char* c, size_t len);
+
+	// Returns the length of member's header, 0 if header is not complete, or -1 if it is invalid
+	//	@c: supposed beginning of member
+	//	@len: number of available chars
+	static int HeaderLen(const char* c, size_t len);
+
+	// Returns true if valid header of dynamic Huffman block, which is not the last one, begins at batch bit offset
+	//	@pos: batch bit offset
+	bool IsBlock(size_t pos) const;
+
+	// Returns batch offset of the supposed beginning of member, or 0 if it is not found
+	//	@from: batch offset to start searching
+	//	@to: batch offset to stop searching
+	size_t FindMember(size_t from, size_t to) const;
+
+	// Returns batch bit offset of the supposed beginning of member or block, or 0 if it is not found
+	//	@from: batch offset to start searching
+	//	@to: batch offset to stop searching
+	//	@inMember: returned true if block is found
+	size_t FindBlock(size_t from, size_t to, bool& inMember) const;
+
+	// Replaces marks in the beginning of chunk depending on the window by chars of the true window
+	//	@chunk: accepted chunk
+	//	return: false if data are invalid
+	bool Patch(Chunk& chunk);
+
+	// Checks CRC32 and length of members ended in chunk and keeps the last data as the window
+	//	@chunk: accepted chunk
+	//	return: false if member is corrupted
+	bool Accept(const Chunk& chunk);
+
+	// Reads and inflates the next batch.
+	//	return: 1 if batch is inflated; 0 if file is finished; -1 if unsuccess reading
+	int ReadBatch();
+
+	// Returns the total length of batch and chunks' buffers
+	size_t Capacity() const;
+
+public:
+	// Returns true if file is gzip one
+	//	@fName: name of file
+	static bool IsGzip(const char* fName);
+
+	// Creates new instance
+	//	@file: opened gzip file
+	//	@threadCnt: number of inflating threads
+	Unzipper(FILE* file, BYTE threadCnt);
+
+	inline ~Unzipper()	{ fclose(_file); Memory::Add(Memory::UNZIP, -LLONG(Capacity())); }
+
+	// Gets the length of read compressed data
+	inline ULLONG InLength() const	{ return _inLen; }
+
+	// Reads inflated chars.
+	//	@buff: buffer to read
+	//	@len: number of chars to read
+	//	return: number of readed chars or -1 if unsuccess reading
+	int Read(char* buff, UINT len);
+};
+
+// 'Zipper' writes gzip file as a sequence of independent BGZF members deflated by few threads.
+// Data are accumulated in a batch; the filled batch is deflated in the background
+// while the next one is accumulated, and members are written in input order.
+class Zipper
+{
+private:
+	// 'Part' is a part of batch deflated by one thread
+	struct Part {
+		const char*	Data;		// uncompressed content
+		size_t	DataLen;		// length of uncompressed content
+		vector<char> Out;		// BGZF members
+		size_t	OutLen;			// length of BGZF members
+		bool	Error;			// true if deflating is failed
+	};
+	// 'Batch' is a data deflated in parallel
+	struct Batch {
+		vector<char>	Data;		// uncompressed content
+		size_t			DataLen;	// length of uncompressed content
+		vector<Part>	Parts;
+		vector<Thread*>	Threads;	// deflating threads; empty if batch is not deflated
+	};
+
+	FILE*	_file;
+	Batch	_batches[2];	// accumulated and deflated batches
+	BYTE	_ind;			// index of accumulated batch
+	bool	_error;			// true if deflating or writing is failed
+
+	// Deflates part of batch into BGZF members; thread procedure
+	//	@part: part to deflate
+	static retThreadValType
+#ifdef OS_Windows
+		__stdcall
+#endif
+		Deflate(void* part);
+
+	// Starts deflating the accumulated batch and switches to another one
+	void StartBatch();
+
+	// Waits for deflating of batch and writes it
+	//	@batch: batch to write
+	void WriteBatch(Batch& batch);
+
+	// Returns the total length of batches' and parts' buffers
+	size_t Capacity() const;
+
+	// Returns the number of batches being deflated
+	inline BYTE DeflatedCount() const {
+		return BYTE(!_batches[0].Threads.empty() + !_batches[1].Threads.empty());
+	}
+
+public:
+	// Creates new instance
+	//	@file: file opened for writing
+	//	@threadCnt: number of deflating threads
+	Zipper(FILE* file, BYTE threadCnt);
+
+	inline ~Zipper()	{ Close(); Memory::Add(Memory::ZIP, -LLONG(Capacity())); }
+
+	// Adds chars to write.
+	//	@data: chars to write
+	//	@len: number of chars
+	//	return: true if successful
+	bool Write(const char* data, size_t len);
+
+	// Writes all accumulated chars and BGZF end-of-file marker and closes file.
+	//	return: true if successful
+	bool Close();
+};
+#endif
+
 #define _buffLineOffset _readingLen
 
+// 'TxtBuffers' keeps the read buffers of TxtFile to reuse them by the files read one after another.
+// Saves the allocation of big buffers when many files are treated by the same thread.
+// Is not thread-safe: each thread should have its own instance.
+class TxtBuffers
+{
+private:
+	char*	_buffs[2];	// kept buffers: basic or the pair of read-ahead ones
+	UINT	_lens[2];	// lengths of kept buffers
+
+public:
+	inline TxtBuffers()		{ _buffs[0] = _buffs[1] = NULL; _lens[0] = _lens[1] = 0; }
+
+	inline ~TxtBuffers() {
+		delete [] _buffs[0]; delete [] _buffs[1];
+		Memory::Add(Memory::READ, -LLONG(_lens[0] + _lens[1]));
+	}
+
+	// Gets kept buffer, increased if necessary
+	//	@ind: index of buffer
+	//	@len: required length
+	char* Get(BYTE ind, UINT len);
+};
+
 class TxtFile
 /*
  * Basic class 'TxtFile' implements a fast buffered serial (stream) reading/writing text files 
  * (in Windows and Linux standart).
  * Supports reading/writing zipped (gz) files.
  * Optimised for huge files.
- * Restriction: the default size of buffer, setting as NUMB_BLK * BASE_BLK_SIZE, 
- * should be bigger than the longest line in file. Otherwise file become invalid,
- * and less than UINT.
+ * The size of basic buffer is set by BuffLen, NUMB_BLK * BASE_BLK_SIZE by default.
+ * The record longer than buffer is read into the spill buffer, which grows as needed
+ * and is left as soon as the records fit the basic buffer again.
  * If size of reading files is less than default buffer's size, 
  * the buffer's size sets exactly to be sufficient to read a whole file.
+ * Standard input ("stdin") is read as a big file of unknown length;
+ * gzip stream is recognized by its magic bytes.
  * The reading/writing unit is a 'record', which in common case is a predifined set of lines.
  * For FQ files 'record' is a set of 4 lines.
  * For common text files 'record' is identical to 'line'.
  * Empty lines are skipping by reading and therefore will not be writing by 'cloning' a file.
+ * Uncompressed regular file can be read in mapped mode: the buffer is a sliding window
+ * of the file mapped into memory, so records are neither copied nor moved.
+ * In this mode the buffer is read-only and records are not null-terminated.
+ * Other big files are read in read-ahead mode in multithreading build:
+ * the basic buffer is split into two blocks, and the next block is read (unzipped)
+ * by separate thread while the current one is treated.
  */
 {
 public:
@@ -36,6 +332,9 @@ public:
 		ALL		// creates file if it not exist and reads it
 	};
 
+	// Length of basic buffer; should be less than UINT
+	static UINT BuffLen;
+
 private:
 	enum eFlag {			// signs of file
 		CLONE		= 0x001,	// file is a clone
@@ -46,18 +345,28 @@ private:
 		CRCHECKED	= 0x020,	// the presence of a symbol CR is checked; for Reading mode
 		ENDREAD		= 0x040,	// last call of GetRecord() has returned NULL; for Reading mode
 		PRNAME		= 0x080,	// print file name in exception's message; for Reading mode
-		MTHREAD		= 0x100		// file in multithread mode: needs to be locked while writing
+		MTHREAD		= 0x100,	// file in multithread mode: needs to be locked while writing
+		MAPPED		= 0x200,	// file is read through memory mapping; for Reading mode
+		READAHEAD	= 0x400,	// next block is read by separate thread; for Reading mode
+		UNZIPPER	= 0x800,	// multi-member gzip file is inflated by few threads; for Reading mode
+		ZIPPER		= 0x1000,	// zipped file is written as BGZF by few threads; for Writing mode
+		STDIN		= 0x2000,	// file is standard input of unknown length; for Reading mode
+		WRMODE		= 0x4000,	// file is opened for writing; used in memory accounting only
+		ZBUFF		= 0x8000,	// buffers of zlib stream are accounted; used in memory accounting only
+		PROGRESS	= 0x10000	// read chars and records are reported to Progress; for Reading mode
 	};
 	enum eBuff {		// signs of buffer; used in CreateBuffer() only
 		BUFF_BASIC,		// basic (block) read|write buffer
-		BUFF_LINE		// line write buffer
+		BUFF_LINE,		// line write buffer
+		BUFF_AHEAD		// pair of read-ahead buffers
 	};
 
 	string	_fName;			// file's name
 	LLONG	_fSize;			// the length of uncompressed file; for zipped file more than
 							// 4'294'967'295 its unzipped length is unpredictable
 	void *	_stream;		// FILE* (for unzipped file) or gzFile (for zipped file)
-	mutable short _flag;	// bitwise storage for signs included in eFlag
+							// or Unzipper*, Zipper* (for zipped file in UNZIPPER, ZIPPER mode)
+	mutable UINT _flag;		// bitwise storage for signs included in eFlag
 	// === basic read|write buffer
 	char *	_buff;			// basic accumulative read/write buffer
 	UINT *	_linesLen;		// for Reading mode only: array of lengths of lines in a record
@@ -66,12 +375,39 @@ private:
 	ULONG	_cntRecords;	// counter of readed/writed records
 	BYTE	_cntRecLines;	// number of lines in a record
 	UINT	_recLen;		// for Reading mode only: the length of record with EOL marker
+	// === spill buffer; for Reading mode
+	char*	_spill;			// buffer of the record longer than basic buffer, or NULL
+	UINT	_spillLen;		// length of spill buffer
+	char*	_basic;			// basic buffer replaced by spill buffer; without read-ahead only
+	UINT	_basicLen;		// length of replaced basic buffer
+	// === progress; for Reading mode
+	ULLONG	_progOffset;	// consumed offset in file at the last report to Progress
+	ULONG	_progRecords;	// number of records at the last report to Progress
 	// === basic & line buffer common use
 	UINT	_readingLen;	// while file reading: number of actually readed chars in block
 							// while line writing: current shift from the _buffLine
+	ULLONG	_readTotal;		// number of chars read from file; for Reading mode
+	ULLONG	_readOffset;	// offset in file after the read chars, compressed one for zipped file;
+							// for Reading mode
+#ifndef OS_Windows
+	// === mapped mode
+	void*	_map;			// start of the mapped window
+	size_t	_mapLen;		// length of the mapped window
+	LLONG	_buffPos;		// file offset of the basic buffer
+#endif
+#ifdef _MULTITHREAD
+	// === read-ahead mode
+	char*	_raBuff[2];		// read-ahead buffers, each of _raHeadLen + _raBlkLen + 1 length
+	UINT	_raBlkLen;		// length of read-ahead block
+	UINT	_raHeadLen;		// length of room before read-ahead block
+	int		_raLen;			// number of chars read ahead, or -1 if reading is failed
+	BYTE	_raInd;			// index of the buffer that is read ahead
+	Thread*	_raThread;		// thread that reads ahead
+#endif
 	// === line write buffer
 	char*	_buffLine;		// line write buffer; for writing mode only
 	rowlen	_buffLineLen;	// length of line write buffer in writing mode, otherwise 0
+	TxtBuffers*	_buffers;	// owner of read buffers, or NULL if buffers are owned by this instance
 	//rowlen	_buffLineOffset;// current shift from the _buffLine; replacement by #define!!!
 protected:
 	char	_delim;
@@ -90,12 +426,57 @@ private:
 	//	return: 1 if file is not finished; 0 if it is finished; -1 if unsuccess reading
 	int ReadBlock(const UINT offset);
 
+	// Makes the spill buffer current, grown if necessary, and moves the untreated rest of record to it.
+	//	@len: required length of buffer
+	//	@restLen: length of untreated rest of record at the beginning of current buffer
+	//	return: true if success
+	bool Spill(UINT len, UINT restLen);
+
+	// Reads chars from file.
+	//	@buff: buffer to read
+	//	@len: number of chars to read
+	//	return: number of readed chars or -1 if unsuccess reading
+	int Read(char* buff, UINT len) const;
+
+	// Adds the number of read chars and updates the offset in file.
+	// Should be called while file is not read ahead.
+	//	@len: number of read chars
+	void CountRead(UINT len);
+
+	// Reports the chars consumed and records read since the last report to Progress
+	//	@offset: offset in file before the unconsumed chars
+	void ReportProgress(ULLONG offset);
+
+#ifdef _MULTITHREAD
+	// Starts reading the next block ahead by separate thread.
+	void StartReadAhead();
+
+	// Reads the next block ahead; thread procedure
+	//	@file: this instance
+	static retThreadValType
+#ifdef OS_Windows
+		__stdcall
+#endif
+		ReadAhead(void* file);
+#endif
+
+#ifndef OS_Windows
+	// Returns true if file can be read in mapped mode.
+	bool CanMap() const;
+
+	// Maps next window of file in mapped mode.
+	//	@offset: shift of start mapping position relative to the current buffer
+	//	return: true if success
+	bool MapBlock(const UINT offset);
+#endif
+
 	// Initializes instance variables and opens a file with setting a proper error code.
 	//	@fName: valid full name of file
 	//	@mode: opening mode
 	//	@file: clonable file or NULL
+	//	@threadCnt: number of threads inflating multi-member gzip file
 	//	return: true is success, otherwise false.
-	bool SetBasic(const string& fName, eAction mode, void* file);
+	bool SetBasic(const string& fName, eAction mode, void* file, BYTE threadCnt=1);
 	
 	// Allocates memory for file read/write buffer or write line buffer with checking.
 	//	return: true if successful
@@ -122,7 +503,12 @@ protected:
 	//	@cntRecLines: number of lines in a record
 	//	@abortInvalid: true if invalid instance shold be completed by throwing exception
 	//	@rintName: true if file name should be printed in the exception's message
-	TxtFile(const string& fName, eAction mode, BYTE cntRecLines, bool abortInvalid=true, bool printName=true);
+	//	@mapped: true if uncompressed regular file should be read in mapped mode
+	//	@threadCnt: number of threads inflating multi-member gzip file
+	//	@buffers: owner of reused read buffers, or NULL if buffers should be allocated
+	TxtFile(const string& fName, eAction mode, BYTE cntRecLines,
+		bool abortInvalid=true, bool printName=true, bool mapped=false, BYTE threadCnt=1,
+		TxtBuffers* buffers=NULL);
 
 #ifdef _MULTITHREAD
 	// Creates new instance with read buffer belonges to aggregated file: constructor for concatenating.
@@ -150,6 +536,12 @@ protected:
 	// Returns true if instance is a clone.
 	inline bool IsClone() const { return IsFlag(CLONE); }	// return _isClone;
 
+	// Returns true if file is read in mapped mode, so records are not null-terminated.
+	inline bool IsMapped() const { return IsFlag(MAPPED); }
+
+	// Returns pointer after the last readed char in basic buffer
+	inline const char* BuffEnd() const { return _buff + _readingLen; }
+
 	// Sets error code and throws exception if it is allowed.
 	void SetError(Err::eCode errCode) const;
 
@@ -176,6 +568,28 @@ protected:
 	//	return: point to the next record in a buffer.
 	inline const char* NextRecord() const	{ return _buff + _currRecPos; }
 
+	// Gets next record for decoding in place, if it is a single non-empty line ended by EOL in current block.
+	// Decoded record should be accepted by AcceptLine().
+	//	@eol: returned pointer to EOL of line
+	//	return: point to line, or NULL if record should be read by GetRecord()
+	inline const char* PeekLine(const char*& eol) const
+	{
+		if( _cntRecLines != 1 || _currRecPos >= _readingLen || !IsFlag(CRCHECKED) )
+			return NULL;
+		const char* line = _buff + _currRecPos;
+		eol = (const char*)memchr(line, EOL, _readingLen - _currRecPos);
+		return eol && eol != line ? line : NULL;
+	}
+
+	// Sets the line got by PeekLine() as current record
+	//	@eol: pointer to EOL of line
+	inline void AcceptLine(const char* eol)
+	{
+		_recLen = _linesLen[0] = UINT(eol - _buff) - _currRecPos + 1;
+		_currRecPos += _recLen;
+		_cntRecords++;
+	}
+
 	// Sets _currLinePos to the beginning of next non-empty line inread/write buffer.
 	//	@counterN: if not NULL, adds to counterN the number of 'N' in a record. Used in Fa() only.
 	//	@posTab: if not NULL, sets TABs positions in line to this array
@@ -367,11 +781,25 @@ public:
 	// Gets size of uncompressed file,
 	// or size of compressed file if its uncompressed length is more than UINT_MAX.
 	// So it can be used for estimatation only.
+	// For standard input it is the maximum LLONG value since its length is unknown.
 	inline LLONG Length() const	{ return _fSize; }
 
+	// Gets number of chars read from file, including the ones read ahead
+	inline ULLONG ReadLength() const	{ return _readTotal; }
+
+	// Gets offset in file after the read chars: compressed one for zipped file.
+	// For zipped file read by old zlib it is equal to ReadLength().
+	inline ULLONG ReadOffset() const	{ return _readOffset; }
+
+	// Gets number of treated chars: the read ones without untreated rest of current block
+	inline ULLONG ReadPosition() const	{ return _readTotal - (_readingLen - _currRecPos); }
+
 	// Gets file name.
 	inline const string& FileName() const	{ return _fName; }
 
+	// Starts reporting the read chars and records to Progress, if it is enabled
+	void TrackProgress();
+
 	// Gets number of readed/writed records.
 	inline ULONG RecordCount() const	{ return _cntRecords; }
 
@@ -592,6 +1020,18 @@ private:
 	//	@fInd: field index
 	inline const char* SField(BYTE fInd) const { return _currLine + _fieldPos[fInd]; }
 
+	// Parses unsigned decimal integer.
+	//	@s: chars to parse
+	//	@end: pointer after the last readable char
+	//	@val: parsed value
+	//	return: pointer to the char after the last digit, or NULL if there are no digits or value exceeds UINT
+	static const char* ParseUInt(const char* s, const char* end, UINT& val);
+
+	// Checks the end of parsed integer field and throws exception if it is invalid.
+	//	@end: pointer to the char after the last digit, or NULL if parsing is failed
+	//	return: @end
+	const char* CheckNumbEnd(const char* end) const;
+
 	// Initializes new instance.
 	//	@mode: action mode (read, write, all)
 	void Init(eAction mode);
@@ -608,6 +1048,10 @@ public:
 	//	@abortInvalid: true if invalid instance should be completed by throwing exception
 	//	@rintName: true if file name should be printed in exception's message
 	//	@checkFieldCnt: true if fields count should be checked; for reading only
+	//	@mapped: true if uncompressed file should be read in mapped mode;
+	//	then fields are not null-terminated and are ended by TAB or EOL
+	//	@threadCnt: number of threads inflating multi-member gzip file
+	//	@buffers: owner of reused read buffers, or NULL if buffers should be allocated
 	TabFile(
 		const string& fName,
 		eAction mode=READ,
@@ -617,10 +1061,13 @@ public:
 		const char* lineSpec=NULL,
 		bool abortInvalid=true,
 		bool printName=true,
-		bool checkFieldCnt=true
+		bool checkFieldCnt=true,
+		bool mapped=false,
+		BYTE threadCnt=1,
+		TxtBuffers* buffers=NULL
 	) : _params(minCntFields, (maxCntFields==1 ? minCntFields : maxCntFields) + 1, comment, lineSpec),
 		_checkFieldCnt(checkFieldCnt),
-		TxtFile(fName, mode, 1, abortInvalid, printName)
+		TxtFile(fName, mode, 1, abortInvalid, printName, mapped, threadCnt, buffers)
 	{	Init(mode); }
 
 	// Creates new instance for reading
@@ -695,7 +1142,194 @@ public:
 	long LongField	(BYTE fInd)	const {
 		return IsFieldValid(fInd) ? long(atol(SField(fInd))) : vUNDEF;
 	}
+
+	// Reads unsigned integer by field's index from current line.
+	// Faster than IntField(): does not skip blanks and does not depend on locale.
+	//	@fInd: field index
+	//	@val: returned value
+	//	return: pointer to the char after the value, or NULL if field is absent and not obligatory
+	//	Exception: file_error if field is not a valid integer
+	const char* UIntField(BYTE fInd, UINT& val) const {
+		return IsFieldValid(fInd) ?
+			CheckNumbEnd(ParseUInt(SField(fInd), BuffEnd(), val)) : NULL;
+	}
+
+	// Reads integer by field's index from current line.
+	// Faster than IntField(): does not skip blanks and does not depend on locale.
+	//	@fInd: field index
+	//	@val: returned value
+	//	return: pointer to the char after the value, or NULL if field is absent and not obligatory
+	//	Exception: file_error if field is not a valid integer
+	const char* IntField(BYTE fInd, int& val) const;
+
+	// Decodes the following data lines "position TAB value" into arrays.
+	// Decoding is stopped by a non-data line, the end of file or full arrays.
+	// Lines beginning with digit are data ones; lines that are not just two decimal integers
+	// are read and checked as by GetLine() with UIntField() and IntField().
+	//	@pos: array of positions
+	//	@vals: array of values
+	//	@maxCnt: capacity of arrays
+	//	@line: returned non-data line that stopped decoding and set as current, or NULL
+	//	return: number of decoded lines; if it is less than @maxCnt and @line is NULL, file is ended
+	//	Exception: file_error if data line is invalid
+	ULONG GetData(chrlen* pos, int* vals, ULONG maxCnt, const char*& line);
+};
+
+#ifdef _WIGREG
+// 'TrackRecord' is a regulated wiggle record
+struct TrackRecord {
+	chrlen	Pos;	// 1-based position
+	chrlen	Span;	// length
+	int		Val;	// value; negative one takes the longest varint
+};
+
+// 'TrackChrom' is an item of binary track's chromosome directory
+struct TrackChrom {
+	string	Name;
+	ULLONG	RecCnt;		// number of records
+	UINT	FirstBlock;	// index of the first block
+	UINT	BlockCnt;	// number of blocks
+};
+
+// 'TrackWriter' writes regulated records as compact binary track.
+// Records of each chromosome are packed into blocks of up to TRACK_BLOCK_SIZE records.
+// Block consists of header (number of records and lengths of 3 columns, UINT each)
+// and columns of varint-encoded position gaps from the previous record's end,
+// span deltas and values; each block is decoded independently.
+// Footer keeps chromosome directory and block offsets:
+// for each chromosome: name length (USHORT), name, number of records (ULLONG),
+// index of the first block and number of blocks (UINT);
+// then block offsets (ULLONG), number of chromosomes and blocks (UINT), footer offset (ULLONG), magic.
+// File begins with magic and version (UINT). Values are in native byte order.
+class TrackWriter
+{
+private:
+	FILE*	_file;
+	ULLONG	_offset;				// current file offset
+	vector<TrackChrom>	_chroms;	// chromosome directory
+	vector<ULLONG>		_blocks;	// block offsets
+	vector<TrackRecord>	_recs;		// records of current block
+	vector<BYTE>		_cols[3];	// encoded columns of current block
+	bool	_error;					// true if writing is failed
+
+	// Writes data to file
+	void Write(const void* data, size_t len);
+
+	// Encodes and writes current block
+	void WriteBlock();
+
+public:
+	// Creates new instance
+	//	@fName: file name
+	TrackWriter(const char* fName);
+
+	inline ~TrackWriter()	{ Close(); }
+
+	// Sets current chromosome
+	//	@name: chromosome's name
+	void SetChrom(const string& name);
+
+	// Adds records of current chromosome
+	//	@recs: records
+	//	@cnt: number of records
+	void Add(const TrackRecord* recs, size_t cnt);
+
+	// Writes the rest of records and footer, and closes file
+	//	return: true if successful
+	bool Close();
+};
+
+// 'TrackReader' reads binary track written by TrackWriter.
+// File is mapped in memory entirely (read in Windows), and records are decoded on the fly.
+class TrackReader
+{
+private:
+	const string _fName;			// file's name
+	const BYTE*	_data;				// file content
+	size_t		_len;				// length of file
+	vector<TrackChrom>	_chroms;	// chromosome directory
+	vector<ULLONG>		_blocks;	// block offsets
+	ULLONG		_dirOffset;			// footer offset: the end of blocks
+	// === iteration state
+	UINT		_block, _endBlock;	// current and after the last block of current chromosome
+	UINT		_recCnt;			// number of records remaining in current block
+	const BYTE*	_cols[3];			// current positions in columns of current block
+	const BYTE*	_colEnds[3];		// ends of columns of current block
+	TrackRecord	_rec;				// previous record of current block
+
+	// Releases file content
+	void Release();
+
+	// Reads chromosome directory and block offsets
+	//	return: false if footer is invalid
+	bool ReadFooter();
+
+	// Sets next block of current chromosome
+	//	return: false if there are no more blocks
+	bool NextBlock();
+
+	// Throws exception of invalid format
+	void Invalid() const;
+
+	// Decodes varint of current block's column
+	//	@col: index of column; its position is moved after varint
+	inline UINT Decode(BYTE col) {
+		const BYTE*& p = _cols[col];
+		UINT val = 0;
+		for(BYTE shift = 0; ; shift += 7) {
+			if( p == _colEnds[col] || shift > 28 )	Invalid();
+			val |= UINT(*p & 0x7F) << shift;
+			if( !(*p++ & 0x80) )	return val;
+		}
+	}
+
+	// Decodes zigzag varint of signed difference of current block's column
+	//	@col: index of column; its position is moved after varint
+	inline int DecodeGap(BYTE col) {
+		const UINT val = Decode(col);
+		return int(val >> 1) ^ -int(val & 1);
+	}
+
+public:
+	// Returns true if file is binary track
+	//	@fName: file name
+	static bool IsTrack(const char* fName);
+
+	// Opens binary track
+	//	@fName: file name
+	TrackReader(const char* fName);
+
+	inline ~TrackReader()	{ Release(); }
+
+	// Gets number of chromosomes
+	inline size_t ChromCount() const	{ return _chroms.size(); }
+
+	// Gets chromosome's name
+	//	@ind: index of chromosome
+	inline const string& ChromName(size_t ind) const	{ return _chroms[ind].Name; }
+
+	// Gets number of chromosome's records
+	//	@ind: index of chromosome
+	inline ULLONG RecordCount(size_t ind) const			{ return _chroms[ind].RecCnt; }
+
+	// Starts iteration through chromosome's records
+	//	@ind: index of chromosome
+	void SetChrom(size_t ind);
+
+	// Gets next record of current chromosome
+	//	@rec: returned record
+	//	return: false if there are no more records
+	inline bool NextRecord(TrackRecord& rec) {
+		if( !_recCnt && !NextBlock() )	return false;
+		_rec.Pos += _rec.Span + DecodeGap(0);
+		_rec.Span += DecodeGap(1);
+		_rec.Val = int(Decode(2));
+		_recCnt--;
+		rec = _rec;
+		return true;
+	}
 };
+#endif	// _WIGREG
 
 #if !defined _WIGREG
 
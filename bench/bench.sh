@@ -0,0 +1,101 @@
+#!/bin/sh
+# Reproducible end-to-end benchmark of wigReg.
+# Generates synthetic MACS and PeakRanger wiggles by wigGen, plain and compressed,
+# and times wigReg across resolutions and numbers of threads.
+# For the MACS wiggle the resolution is the span of generated data, since wigReg ignores -s for MACS;
+# for the PeakRanger wiggle it is the value of wigReg's -s option.
+#
+# Parameters are set by environment variables:
+#	GENOME	genome size in Mbp [100]
+#	CHROMS	number of chromosomes [4]
+#	DENSITY	percent of covered spans [80]
+#	DISTR	value distribution: walk, uniform or geom [walk]
+#	SEED	generator's seed [1]
+#	SPACES	list of resolutions [1 5 10]
+#	THREADS	list of numbers of threads [1 2 4]
+#	REPEAT	number of runs; the best time is reported [3]
+#	DIR		directory of generated data [bench/data]
+#	OUT		file to save the table as TSV; not saved if empty []
+# Example: GENOME=1000 THREADS="1 8" sh bench/bench.sh
+
+cd "$(dirname "$0")/.." || exit 1
+WIGREG=./wigReg
+WIGGEN=bench/wigGen
+GENOME=${GENOME:-100}
+CHROMS=${CHROMS:-4}
+DENSITY=${DENSITY:-80}
+DISTR=${DISTR:-walk}
+SEED=${SEED:-1}
+SPACES=${SPACES:-"1 5 10"}
+THREADS=${THREADS:-"1 2 4"}
+REPEAT=${REPEAT:-3}
+DIR=${DIR:-bench/data}
+OUT=${OUT:-}
+
+for f in $WIGREG $WIGGEN; do
+	[ -x $f ] || { echo "$f is not built: run 'make bench'" >&2; exit 1; }
+done
+mkdir -p $DIR || exit 1
+
+# prints current time in nanoseconds
+now() { date +%s%N; }
+
+# generates wiggle if it does not exist yet; the name keeps all parameters, so data is never stale
+#	$1: style, $2: span, $3: extension
+gen() {
+	name=$DIR/$1-g$GENOME-c$CHROMS-s$2-d$DENSITY-$DISTR-r$SEED.wig$3
+	[ -s $name ] || $WIGGEN -p $1 -g $GENOME -c $CHROMS -s $2 -d $DENSITY -v $DISTR -r $SEED $name || exit 1
+	echo $name
+}
+
+# runs wigReg REPEAT times and prints the best time in seconds
+#	$@: wigReg arguments
+best() {
+	min=
+	i=0
+	while [ $i -lt $REPEAT ]; do
+		start=$(now)
+		$WIGREG "$@" > /dev/null || { echo "wigReg $* failed" >&2; exit 1; }
+		t=$(( $(now) - start ))
+		[ -z "$min" ] || [ $t -lt $min ] && min=$t
+		i=$((i + 1))
+	done
+	awk -v t=$min 'BEGIN { printf "%.3f", t / 1e9 }'
+}
+
+header="prog	space	input	threads	in,MB	records	out,MB	time,s	MB/s	records/s"
+echo "$header"
+[ -n "$OUT" ] && echo "$header" > $OUT
+
+for prog in MACS PR; do
+	for space in $SPACES; do
+		if [ $prog = MACS ]; then
+			span=$space
+			opt=
+		else
+			span=1
+			opt="-s $space"
+		fi
+		plain=$(gen $prog $span "") || exit 1
+		zipped=$(gen $prog $span .gz) || exit 1
+		records=$(grep -c '^[0-9]' $plain)
+		for in in $plain $zipped; do
+			case $in in *.gz) kind=gz; ext=.wig.gz;; *) kind=wig; ext=.wig;; esac
+			out=$DIR/out$ext
+			for threads in $THREADS; do
+				time=$(best -p $prog $opt --threads $threads $in $out) || exit 1
+				line=$(awk -v p=$prog -v s=$space -v k=$kind -v th=$threads -v t=$time \
+					-v isz=$(wc -c < $in) -v osz=$(wc -c < $out) -v r=$records 'BEGIN {
+					mb = 1024 * 1024
+					if( t <= 0 )	t = 0.001
+					printf "%s\t%d\t%s\t%d\t%.1f\t%d\t%.1f\t%.3f\t%.1f\t%.0f",
+						p, s, k, th, isz/mb, r, osz/mb, t, isz/mb/t, r/t
+				}')
+				echo "$line"
+				[ -n "$OUT" ] && echo "$line" >> $OUT
+			done
+			rm -f $out
+		done
+	done
+done
+exit 0
@@ -0,0 +1,261 @@
+/*
+	microBench measures the parsing and formatting kernels of wigReg
+	on synthetic data kept in memory, separately from I/O.
+	For each kernel it reports the best of several runs in ns per line (call)
+	and bytes per CPU cycle (time stamp counter cycle).
+
+	Copyright (C) 2017 Fedor Naumenko (fedor.naumenko@gmail.com)
+
+	This program is free software. It is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY;
+	without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+	See the	GNU General Public License for more details.
+ */
+
+#include "../def.h"
+#include <algorithm>	// should be included before common.h
+#include <list>
+#include "../common.h"
+#include "../TxtFile.h"
+#include "../BigWigFile.h"
+#include "../wigReg.h"
+#ifdef OS_Windows
+	#include <intrin.h>		// __rdtsc()
+#elif defined __x86_64__ || defined __i386__
+	#include <x86intrin.h>	// __rdtsc()
+	#define TSC
+#endif
+#ifdef _MSC_VER
+	#define TSC
+#endif
+
+const char* Usage =
+"microBench: wigReg kernels microbenchmark\n\n"
+"Usage:\tmicroBench [options]\n\n"
+"Options:\n"
+"  -n <int>\tnumber of data lines [4000000]\n"
+"  -r <int>\tnumber of runs; the best one is reported [5]\n";
+
+// Returns CPU's time stamp counter, or 0 if it is unavailable
+inline ULLONG Cycles()
+{
+#ifdef TSC
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+// 'Measure' keeps the best run of kernel
+class Measure
+{
+	const char*	_name;
+	ULLONG	_ns, _cycles;		// the best run's time and cycles
+	ULLONG	_startNs, _startCycles;
+
+public:
+	inline Measure(const char* name) : _name(name), _ns(ULLONG(-1)), _cycles(0) {}
+
+	// Starts run
+	inline void Start()	{ _startCycles = Cycles(); _startNs = Timer::Now(); }
+
+	// Stops run and keeps it if it is the best one
+	inline void Stop() {
+		const ULLONG ns = Timer::Now() - _startNs;
+		const ULLONG cycles = Cycles() - _startCycles;
+		if( ns < _ns )	{ _ns = ns; _cycles = cycles; }
+	}
+
+	// Prints the best run
+	//	@cnt: number of treated lines (calls)
+	//	@bytes: number of treated bytes, or 0 if kernel does not treat text
+	void Print(ULLONG cnt, ULLONG bytes) const
+	{
+		cout << left << setw(24) << _name << right << fixed
+			 << setw(12) << cnt
+			 << setw(10) << setprecision(2) << double(_ns) / cnt;
+		if( bytes && _cycles )	cout << setw(12) << setprecision(3) << double(bytes) / _cycles;
+		else					cout << setw(12) << '-';
+		if( bytes )	cout << setw(10) << setprecision(1) << bytes / 1048576. / (_ns / 1e9) << EOL;
+		else		cout << setw(10) << '-' << EOL;
+	}
+};
+
+// 'RecordFile' exposes TxtFile::GetRecord()
+class RecordFile : public TxtFile
+{
+public:
+	inline RecordFile(const string& fName) : TxtFile(fName, READ, 1) {}
+
+	inline char* Next()	{ return GetRecord(); }
+};
+
+// Fills file by MACS-style wiggle with declaration line for each 100000 data lines
+//	@fName: file name
+//	@cnt: number of data lines
+//	return: length of file
+ULLONG Generate(const char* fName, ULONG cnt)
+{
+	FILE* file = fopen(fName, "wb");
+	if( !file )		Err(Err::F_OPEN, fName).Throw();
+	ULLONG len = 0;
+	UINT rnd = 1, pos = 0, val = 1;
+
+	for(ULONG i=0; i<cnt; i++) {
+		if( !(i % 100000) ) {
+			len += fprintf(file, "variableStep chrom=chr%lu span=10\n", i / 100000 % 22 + 1);
+			pos = 1;
+		}
+		rnd = rnd * 1103515245 + 12345;
+		pos += 10 * (1 + (rnd >> 28 == 0));		// gaps are rare
+		if( (rnd >> 16) & 1 )	val = 1 + (rnd >> 20) % 50;
+		len += fprintf(file, "%u\t%u\n", pos, val);
+	}
+	fclose(file);
+	return len;
+}
+
+int main(int argc, char* argv[])
+{
+	ULONG lineCnt = 4000000;
+	int runCnt = 5;
+
+	for(int i=1; i<argc; i++)
+		if( argv[i][0] == '-' && (argv[i][1] == 'n' || argv[i][1] == 'r') && i+1 < argc ) {
+			if( argv[i][1] == 'n' )	lineCnt = atol(argv[++i]);
+			else					runCnt = atoi(argv[++i]);
+		}
+		else {
+			cout << Usage;
+			return argv[i][1] != 'h';
+		}
+	if( !lineCnt || runCnt < 1 )	{ cout << Usage; return 1; }
+
+	char fName[] = "/tmp/microBenchXXXXXX";
+	int fd = mkstemp(fName);
+	if( fd < 0 )	{ cerr << "microBench: cannot create temporary file\n"; return 1; }
+	close(fd);
+
+	try {
+		const ULLONG fLen = Generate(fName, lineCnt);
+		ULONG recCnt = 0;		// number of all lines
+		ULLONG outLen = 0;		// length of formatted output
+		Measure getRecord("TxtFile::GetRecord"), getLine("TabFile::GetLine"),
+			intField("GetLine+IntField x2"), getData("TabFile::GetData"), alignPos("AlignPos"),
+			idByName("Chrom::IDbyAbbrName"), wigLine("WigWriter::Line");
+
+		// positions, values and chromosome names for in-memory kernels
+		vector<chrlen>	pos;
+		vector<wigval>	vals;
+		vector<string>	names;
+		{
+			TabFile file(fName, TxtFile::READ, 2, 2, '\0', NULL, true, true, false);
+			for(const char* line; (line = file.GetLine()) != NULL; )
+				if( isdigit(line[0]) ) {
+					pos.push_back(0);	vals.push_back(0);
+					file.UIntField(0, pos.back());
+					file.IntField(1, vals.back());
+				}
+				else
+					names.push_back(string(strstr(line, Chrom::Abbr), strcspn(strstr(line, Chrom::Abbr), sBLANK)));
+		}
+		for(BYTE c=0; names.size() < 256; c++)	// cover letter names
+			names.push_back(Chrom::AbbrName(c % 25 ? c % 25 : 'X'));
+
+		volatile ULLONG sink = 0;	// keeps results from optimizing away
+		for(int r=0; r<runCnt; r++) {
+			{	// file less than TxtFile's buffer is read by constructor entirely
+				RecordFile file(fName);
+				ULONG cnt = 0;
+				getRecord.Start();
+				while( file.Next() )	cnt++;
+				getRecord.Stop();
+				recCnt = cnt;
+			}
+			{
+				TabFile file(fName, TxtFile::READ, 2, 2, '\0', NULL, true, true, false);
+				ULONG cnt = 0;
+				getLine.Start();
+				while( file.GetLine() )		cnt++;
+				getLine.Stop();
+				sink += cnt;
+			}
+			{
+				TabFile file(fName, TxtFile::READ, 2, 2, '\0', NULL, true, true, false);
+				const char* line;
+				UINT p;
+				int v;
+				ULLONG sum = 0;
+				intField.Start();
+				while( (line = file.GetLine()) != NULL )
+					if( isdigit(line[0]) ) {
+						file.UIntField(0, p);
+						file.IntField(1, v);
+						sum += p + v;
+					}
+				intField.Stop();
+				sink += sum;
+			}
+			{
+				TabFile file(fName, TxtFile::READ, 2, 2, '\0', NULL, true, true, false);
+				const ULONG batch = 4096;
+				const char* line;
+				chrlen p[batch];
+				int v[batch];
+				ULONG cnt;
+				ULLONG sum = 0;
+				getData.Start();
+				do {
+					cnt = file.GetData(p, v, batch, line);
+					for(ULONG i=0; i<cnt; i++)	sum += p[i] + v[i];
+				} while( line || cnt == batch );
+				getData.Stop();
+				sink += sum;
+			}
+			{
+				ULLONG sum = 0;
+				alignPos.Start();
+				for(size_t i=0; i<pos.size(); i++)
+					sum += AlignPos(pos[i], 10, 1);
+				alignPos.Stop();
+				sink += sum;
+			}
+			{
+				ULLONG sum = 0;
+				idByName.Start();
+				for(size_t i=0; i<pos.size(); i++)
+					sum += Chrom::IDbyAbbrName(names[i & 0xFF].c_str());
+				idByName.Stop();
+				sink += sum;
+			}
+			{
+				WigWriter out;		// keeps output in memory
+				wigLine.Start();
+				for(size_t i=0; i<pos.size(); i++)
+					out.Line(pos[i], vals[i]);
+				wigLine.Stop();
+				outLen = out.Length();
+			}
+		}
+
+		cout << "data lines: " << pos.size() << ", all lines: " << recCnt
+			 << ", input: " << fLen << " bytes, best of " << runCnt << " runs\n";
+#ifndef TSC
+		cout << "CPU cycle counter is unavailable: bytes/cycle are not reported\n";
+#endif
+		cout << left << setw(24) << "kernel" << right << setw(12) << "lines"
+			 << setw(10) << "ns/line" << setw(12) << "bytes/cycle" << setw(10) << "MB/s" << EOL;
+		getRecord.Print(recCnt, fLen);
+		getLine.Print(recCnt, fLen);
+		intField.Print(recCnt, fLen);
+		getData.Print(recCnt, fLen);
+		alignPos.Print(pos.size(), 0);
+		idByName.Print(pos.size(), 0);
+		wigLine.Print(pos.size(), outLen);
+		if( !sink )		cout << EOL;
+	}
+	catch(Err &e)				{ remove(fName); cerr << e.what() << EOL; return 1; }
+	catch(const exception &e)	{ remove(fName); cerr << e.what() << EOL; return 1; }
+	remove(fName);
+	return 0;
+}
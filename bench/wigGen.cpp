@@ -0,0 +1,260 @@
+/*
+	wigGen generates synthetic wiggles in the style of MACS and PeakRanger
+	for benchmarking wigReg.
+	Output is fully determined by parameters and seed,
+	so the same data can be reproduced on any platform.
+
+	Copyright (C) 2017 Fedor Naumenko (fedor.naumenko@gmail.com)
+
+	This program is free software. It is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY;
+	without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+	See the	GNU General Public License for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef _NO_ZLIB
+#include <zlib.h>
+#endif
+
+typedef unsigned long long	ULLONG;
+typedef unsigned int		UINT;
+
+enum eStyle { sMACS, sPR };
+enum eDistr { dWALK, dUNIFORM, dGEOM };
+
+const char* Styles[] = { "MACS", "PR" };
+const char* Distrs[] = { "walk", "uniform", "geom" };
+
+const char* Usage =
+"wigGen: deterministic synthetic wiggle generator\n\n"
+"Usage:\twigGen [options] stdout|output.wig[.gz]\n\n"
+"Options:\n"
+"  -p <MACS|PR>\t\tstyle of generated wiggle [MACS]\n"
+"  -g <int>\t\tgenome size in Mbp [100]\n"
+"  -c <int>\t\tnumber of chromosomes [4]\n"
+"  -s <int>\t\tspan in bp [10 for MACS, 1 for PR]\n"
+"  -d <int>\t\tdensity: percent of covered spans [80]\n"
+"  -v <walk|uniform|geom>\tvalue distribution [walk]\n"
+"  -m <int>\t\tmaximum value [50]\n"
+"  -n\t\t\tnegative values, as in PeakRanger's minus strand wiggle\n"
+"  -r <int>\t\tseed [1]\n"
+"Output is compressed if its name ends with '.gz'\n";
+
+// 'Random' is a SplitMix64 generator: the same sequence on all platforms
+class Random
+{
+	ULLONG	_state;
+public:
+	Random(ULLONG seed) : _state(seed) {}
+
+	// Returns next random value
+	ULLONG Next()
+	{
+		ULLONG z = (_state += 0x9E3779B97F4A7C15ULL);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		return z ^ (z >> 31);
+	}
+
+	// Returns random value in range [0, max)
+	inline UINT Range(UINT max) { return UINT(Next() % max); }
+
+	// Returns geometrically distributed value with given mean, at least 1
+	UINT Geom(UINT mean)
+	{
+		UINT val = 1;
+		// 16-bit probability of continuation: (mean-1)/mean
+		const UINT p = mean > 1 ? UINT(65536ULL * (mean-1) / mean) : 0;
+		while( (Next() & 0xFFFF) < p && val < 64*mean )	val++;
+		return val;
+	}
+};
+
+// 'Writer' buffers output lines and writes them to plain or gzip file
+class Writer
+{
+	static const size_t BuffSize = 1 << 16;
+
+	FILE*	_file;
+#ifndef _NO_ZLIB
+	gzFile	_zfile;
+#endif
+	char	_buff[BuffSize + 64];	// reserve for the longest data line
+	size_t	_len;
+
+	void Flush()
+	{
+#ifndef _NO_ZLIB
+		if( _zfile )	gzwrite(_zfile, _buff, UINT(_len));
+		else
+#endif
+			fwrite(_buff, 1, _len, _file);
+		_len = 0;
+	}
+
+	// Adds unsigned integer
+	void AddUInt(UINT val)
+	{
+		char tmp[12];
+		char* p = tmp + sizeof(tmp);
+		do	*--p = char('0' + val % 10);
+		while( val /= 10 );
+		const size_t len = tmp + sizeof(tmp) - p;
+		memcpy(_buff + _len, p, len);
+		_len += len;
+	}
+
+public:
+	// Opens output; returns false if failed
+	Writer(const char* name, bool& success) : _file(NULL), _len(0)
+	{
+#ifndef _NO_ZLIB
+		_zfile = NULL;
+		const size_t len = strlen(name);
+		if( len > 3 && !strcmp(name + len - 3, ".gz") ) {
+			success = (_zfile = gzopen(name, "wb6")) != NULL;
+			return;
+		}
+#endif
+		_file = strcmp(name, "stdout") ? fopen(name, "wb") : stdout;
+		success = _file != NULL;
+	}
+
+	~Writer()
+	{
+		Flush();
+#ifndef _NO_ZLIB
+		if( _zfile )	gzclose(_zfile);
+#endif
+		if( _file && _file != stdout )	fclose(_file);
+	}
+
+	// Writes non-data line
+	void Line(const char* line)
+	{
+		const size_t len = strlen(line);
+		if( _len + len >= BuffSize )	Flush();
+		memcpy(_buff + _len, line, len);
+		_len += len;
+		_buff[_len++] = '\n';
+	}
+
+	// Writes data line
+	void Data(UINT pos, int val)
+	{
+		AddUInt(pos);
+		_buff[_len++] = '\t';
+		if( val < 0 )	{ _buff[_len++] = '-'; val = -val; }
+		AddUInt(UINT(val));
+		_buff[_len++] = '\n';
+		if( _len >= BuffSize )	Flush();
+	}
+};
+
+// Returns index of value in the list, or -1 if absent
+int Find(const char* val, const char** list, int cnt)
+{
+	for(int i=0; i<cnt; i++)
+		if( !strcmp(val, list[i]) )	return i;
+	return -1;
+}
+
+int main(int argc, char* argv[])
+{
+	int style = sMACS, distr = dWALK;
+	UINT genome = 100, chromCnt = 4, span = 0, density = 80, maxVal = 50, seed = 1;
+	bool neg = false;
+	const char* outName = NULL;
+
+	for(int i=1; i<argc; i++) {
+		const char* arg = argv[i];
+		if( arg[0] != '-' || !arg[1] ) {
+			if( outName )	{ fputs(Usage, stderr); return 1; }
+			outName = arg;
+			continue;
+		}
+		if( arg[1] == 'n' )	{ neg = true; continue; }
+		if( arg[1] == 'h' )	{ fputs(Usage, stdout); return 0; }
+		if( ++i == argc ) {
+			fprintf(stderr, "wigGen: option %s requires a value\n", arg);
+			return 1;
+		}
+		const char* val = argv[i];
+		switch(arg[1]) {
+			case 'p': style = Find(val, Styles, 2);	break;
+			case 'v': distr = Find(val, Distrs, 3);	break;
+			case 'g': genome = atoi(val);	break;
+			case 'c': chromCnt = atoi(val);	break;
+			case 's': span = atoi(val);		break;
+			case 'd': density = atoi(val);	break;
+			case 'm': maxVal = atoi(val);	break;
+			case 'r': seed = atoi(val);		break;
+			default:
+				fprintf(stderr, "wigGen: unknown option %s\n", arg);
+				return 1;
+		}
+	}
+	if( !span )	span = style == sMACS ? 10 : 1;
+	if( !outName || style < 0 || distr < 0 || !genome || !chromCnt
+	|| !density || density > 100 || !maxVal ) {
+		fputs(Usage, stderr);
+		return 1;
+	}
+
+	bool success;
+	Writer out(outName, success);
+	if( !success ) {
+		fprintf(stderr, "wigGen: cannot open %s\n", outName);
+		return 1;
+	}
+	Random rnd(ULLONG(seed) * 0x100000001B3ULL + style);
+	char line[256];
+
+	if( style == sMACS )
+		sprintf(line, "track type=wiggle_0 name=\"MACS_tag\" description="
+			"\"Extended tag pileup from MACS version 1.4.2 for every %u bp\"", span);
+	else {
+		out.Line("//Generated by PeakRanger wigpe");
+		sprintf(line, "track type=wiggle_0 name=\"PeakRanger\" description=\"%s strand\"",
+			neg ? "minus" : "plus");
+	}
+	out.Line(line);
+
+	// covered and uncovered runs are geometric; the mean of uncovered ones sets the density
+	const UINT covMean = style == sMACS ? 30 : 8;
+	const UINT gapMean = UINT(covMean * (100 - density) / density) + 1;
+	const UINT chromLen = UINT(ULLONG(genome) * 1000000 / chromCnt);
+	const int sign = neg ? -1 : 1;
+
+	for(UINT c=1; c<=chromCnt; c++) {
+		if( c < chromCnt || chromCnt == 1 )	sprintf(line, "variableStep chrom=chr%u span=%u", c, span);
+		else	sprintf(line, "variableStep chrom=chrX span=%u", span);
+		out.Line(line);
+
+		UINT val = 1 + rnd.Range(maxVal);
+		for(UINT pos = 1 + span * rnd.Range(gapMean); pos + span <= chromLen; ) {
+			for(UINT run = rnd.Geom(covMean); run && pos + span <= chromLen; run--, pos += span) {
+				switch(distr) {
+					case dWALK:
+						if( rnd.Range(2) ) {
+							val += rnd.Range(5);
+							val = val > 2 ? val - 2 : 1;
+							if( val > maxVal )	val = maxVal;
+						}
+						break;
+					case dUNIFORM: val = 1 + rnd.Range(maxVal);	break;
+					case dGEOM:
+						val = rnd.Geom(3);
+						if( val > maxVal )	val = maxVal;
+						break;
+				}
+				out.Data(pos, sign * int(val));
+			}
+			if( density < 100 )	pos += span * rnd.Geom(gapMean);
+		}
+	}
+	return 0;
+}
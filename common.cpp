@@ -1,10 +1,17 @@
 #include "common.h"
 #include <sstream>
+#ifdef __linux__
+	#include <linux/perf_event.h>	// perf_event_attr
+	#include <sys/syscall.h>		// syscall(__NR_perf_event_open)
+#endif
 #ifdef OS_Windows
 	#include <algorithm>
+	#include <psapi.h>		// GetProcessMemoryInfo()
+	#pragma comment(lib, "psapi.lib")
 	#define SLASH '\\'		// standard Windows path separator
 	#define REAL_SLASH '/'	// is permitted in Windows too
 #else
+	#include <sys/resource.h>	// getrusage()
 	#define SLASH '/'	// standard Linux path separator
 #endif
 
@@ -596,10 +603,14 @@ const char* Err::_msgs [] = {
 /* F_WRITE */	"could not write",
 #ifndef _FQSTATN
 /* TF_FIELD */	"number of fields is less than expected",
+/* TF_NUMB */	"field is not a valid integer",
 ///* TF_SPEC */	"wrong line format",
 /* TF_EMPTY */	"no",
 /* BP_BADEND */		"'start' position is equal or more than 'end'",
 /* BP_NEGPOS */		"negative position",
+#ifdef _WIGREG
+/* TR_INVALID */	"is not a valid binary track",
+#endif
 #ifdef _BEDR_EXT
 /* BR_RNAME */	"wrong read name format:",
 #endif
@@ -808,7 +819,16 @@ string const FS::MakePath(const string& name)
 	return name + SLASH;
 }
 
-#ifndef _WIGREG
+// Returns true if the name is absolute path
+//	@name: file or directory name
+bool FS::IsAbsPath(const string& name)
+{
+#ifdef OS_Windows
+	if( (name.length() > 1 && name[1] == ':') || name[0] == REAL_SLASH )	return true;
+#endif
+	return name[0] == SLASH;
+}
+
 // Fills external vector of strings by file's names found in given directory
 // Implementation depends of OS.
 //	@files: external vector of strings that should be filled by file's names
@@ -820,7 +840,7 @@ string const FS::MakePath(const string& name)
 bool FS::GetFiles	(vector<string>& files, const string& dirName,
 	const string& fileExt, bool all)
 {
-	BYTE count = 0;
+	size_t count = 0;
 #ifdef OS_Windows
 	string fileTempl = FS::MakePath(dirName) + '*' + fileExt;
 	WIN32_FIND_DATA ffd;
@@ -855,7 +875,7 @@ bool FS::GetFiles	(vector<string>& files, const string& dirName,
 	}
 	// fill files
 	string name;
-	while( entry = readdir(dir) ) {
+	while( (entry = readdir(dir)) != NULL ) {
 		name = string(entry->d_name);
 		if( HasExt(name, fileExt) ) {
 			files.push_back(name);
@@ -866,7 +886,6 @@ bool FS::GetFiles	(vector<string>& files, const string& dirName,
 	return files.size() > 0;
 #endif	// OS_Windows
 }
-#endif	// _WIGREG
 /************************ end of class FileSystem ************************/
 
 /************************ class FileFormat ************************/
@@ -926,18 +945,21 @@ clock_t	Timer::_StartCPUClock;
 
 // Prints elapsed time interval
 //	@title: string printed before time output
-//	@elapsed: elapsed time interval
+//	@elapsed: elapsed time interval in seconds
 //	@parentheses: if true then output time in parentheses
 //	@isCarrgReturn: if true then ended output by EOL
-void Timer::PrintElapsed(const char *title, long elapsed, bool parentheses, bool isCarrgReturn)
+void Timer::PrintElapsed(const char *title, double elapsed, bool parentheses, bool isCarrgReturn)
 {
+	const long secs = long(elapsed);
+	const long hours = secs/60/60;
+
 	if( title )			dout << title;
 	if( parentheses )	dout << '(';
-	long hours = elapsed/60/60;
 	if( hours )
 		dout << setfill('0') << setw(2) << hours << COLON;
-	dout<< setfill('0') << setw(2) << (elapsed/60%60) << COLON
-	    << setfill('0') << setw(2) << (elapsed%60);
+	dout<< setfill('0') << setw(2) << (secs/60%60) << COLON
+	    << setfill('0') << setw(2) << (secs%60) << DOT
+	    << setfill('0') << setw(3) << long((elapsed - secs) * 1000) << setfill(BLANK);
 	if( parentheses )	dout << ')';
 	if( isCarrgReturn ) {
 		dout << EOL;
@@ -950,7 +972,7 @@ void Timer::PrintElapsed(const char *title, long elapsed, bool parentheses, bool
 void Timer::StopCPU(bool isCarrgReturn)
 {
 	if( Enabled )
-		PrintElapsed("CPU: ", (clock()-_StartCPUClock)/CLOCKS_PER_SEC, false, isCarrgReturn);
+		PrintElapsed("CPU: ", double(clock()-_StartCPUClock)/CLOCKS_PER_SEC, false, isCarrgReturn);
 }
 
 // Stops enabled timer and print elapsed time with title
@@ -959,14 +981,468 @@ void Timer::StopCPU(bool isCarrgReturn)
 //	@isCarrgReturn: if true then ended output by EOL
 void Timer::Stop(const char *title, bool parentheses, bool isCarrgReturn)
 {
-	if( _enabled ) {
-		time_t stopTime;
-		time( &stopTime );
-		PrintElapsed(title, (long)difftime(stopTime, _startTime), parentheses, isCarrgReturn);
-	}
+	if( _enabled )
+		PrintElapsed(title, (Now() - _startTime) / 1e9, parentheses, isCarrgReturn);
 }
 /************************  end of class Timer ************************/
 
+/************************  class PerfCounters ************************/
+bool	PerfCounters::Enabled = false;
+bool	PerfCounters::_Available[PerfCounters::Count];
+const char*	PerfCounters::Titles[] =
+	{ "cycles", "instructions", "branch-misses", "cache-misses", "page-faults" };
+
+// Opens counters of current thread, if they are enabled
+PerfCounters::PerfCounters() : _leader(-1), _cnt(0)
+{
+	for(BYTE i=0; i<Count; i++)		{ _fds[i] = -1; _inds[i] = -1; }
+#ifdef __linux__
+	if( !Enabled )	return;
+	static const struct { UINT Type; ULLONG Config; } events[] = {
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+		{ PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS }
+	};
+	perf_event_attr attr;
+
+	for(BYTE i=0; i<Count; i++) {
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = events[i].Type;
+		attr.config = events[i].Config;
+		attr.read_format = PERF_FORMAT_GROUP;
+		attr.exclude_kernel = attr.exclude_hv = 1;
+		// the first opened counter leads the group: members are read with it
+		const int fd = int(syscall(__NR_perf_event_open, &attr, 0, -1, _leader, 0));
+		if( fd < 0 )	continue;		// counter is unsupported or not permitted
+		if( _leader < 0 )	_leader = fd;
+		_fds[i] = fd;
+		_inds[i] = char(_cnt++);
+		_Available[i] = true;
+	}
+#endif
+}
+
+PerfCounters::~PerfCounters()
+{
+#ifdef __linux__
+	for(BYTE i=0; i<Count; i++)
+		if( _fds[i] >= 0 )	close(_fds[i]);
+#endif
+}
+
+// Reads the values of counters; values of unavailable counters are 0
+//	@vals: array of values
+void PerfCounters::Read(ULLONG* vals) const
+{
+	memset(vals, 0, Count * sizeof(ULLONG));
+#ifdef __linux__
+	ULLONG buff[Count + 1];		// number of values and values in order of opening
+
+	if( _leader < 0 || read(_leader, buff, sizeof(buff)) < ssize_t((_cnt + 1) * sizeof(ULLONG)) )
+		return;
+	for(BYTE i=0; i<Count; i++)
+		if( _inds[i] >= 0 )		vals[i] = buff[1 + _inds[i]];
+#endif
+}
+/************************  end of class PerfCounters ************************/
+
+/************************  class Stages ************************/
+const char*	Stages::_Titles[] = { "other", "read", "tokenize", "parse", "regulate", "output" };
+ULLONG	Stages::_Totals[Stages::Count];
+ULLONG	Stages::_TotalCounts[Stages::Count][PerfCounters::Count];
+THREAD_LOCAL Stages*	Stages::_Local = NULL;
+
+// Adds value to the total thread-safely
+//	@total: total
+//	@val: added value
+inline void AddTotal(ULLONG& total, ULLONG val)
+{
+#ifdef _MULTITHREAD
+	#ifdef OS_Windows
+	InterlockedExchangeAdd64((LONGLONG*)&total, val);
+	#else
+	InterlockedExchangeAdd(&total, val);
+	#endif
+#else
+	total += val;
+#endif
+}
+
+// Distributes the not measured value of line stages in proportion to their measured values,
+// or adds it to the time outside of the stages if line stages are not measured
+//	@vals: values of stages placed with given step
+//	@step: distance between the values of adjacent stages
+//	@rest: distributed value
+void DistributeRest(ULLONG* vals, BYTE step, ULLONG rest)
+{
+	const ULLONG lineVal = vals[Stages::TOKENIZE * step] + vals[Stages::PARSE * step] + vals[Stages::REGULATE * step];
+
+	if( lineVal )
+		for(BYTE i=Stages::TOKENIZE; i<=Stages::REGULATE; i++)
+			vals[i * step] += ULLONG(double(rest) * vals[i * step] / lineVal);
+	else
+		vals[Stages::NONE] += rest;
+}
+
+// Creates and starts accounting of current thread, if timing is enabled
+Stages::Stages() : _rest(0), _start(0), _lineCnt(0), _stage(NONE), _sampled(false), _exact(true), _perf(NULL)
+{
+	memset(_times, 0, sizeof(_times));
+	memset(_counts, 0, sizeof(_counts));
+	memset(_restCounts, 0, sizeof(_restCounts));
+	if( Timer::Enabled ) {
+		if( PerfCounters::Enabled ) {
+			_perf = new PerfCounters();
+			if( _perf->IsOpened() )		_perf->Read(_lastCounts);
+			else	{ delete _perf; _perf = NULL; }
+		}
+		_start = Timer::Now();
+		_Local = this;
+	}
+}
+
+// Stops accounting of current thread and adds its times to the totals
+void Stages::Close()
+{
+	if( _Local != this )	return;
+	Switch(NONE);
+	_Local = NULL;
+	DistributeRest(_times, 1, _rest);
+	for(BYTE i=0; i<Count; i++)		AddTotal(_Totals[i], _times[i]);
+	if( _perf ) {
+		for(BYTE k=0; k<PerfCounters::Count; k++) {
+			DistributeRest(&_counts[0][k], PerfCounters::Count, _restCounts[k]);
+			for(BYTE i=0; i<Count; i++)		AddTotal(_TotalCounts[i][k], _counts[i][k]);
+		}
+		delete _perf;
+		_perf = NULL;
+	}
+}
+
+// Adds the time and counters since the last reading to finished stage
+//	@stage: finished stage
+void Stages::MeasurePerf(eStage stage)
+{
+	const ULLONG now = Timer::Now();
+	ULLONG vals[PerfCounters::Count];
+	ULLONG* counts = _exact ? _counts[stage] : _restCounts;
+
+	_perf->Read(vals);
+	for(BYTE i=0; i<PerfCounters::Count; i++) {
+		counts[i] += vals[i] - _lastCounts[i];
+		_lastCounts[i] = vals[i];
+	}
+	if( _exact )	_times[stage] += now - _start;
+	else			_rest += now - _start;
+	_start = Timer::Now();		// the time of reading counters is excluded
+	_exact = true;
+}
+
+// Prints the totals of stages
+void Stages::Print()
+{
+	ULLONG total = 0;
+	string unavailable;		// names of unavailable counters
+
+	for(BYTE i=0; i<Count; i++)		total += _Totals[i];
+	if( total == _Totals[NONE] )	return;		// timing is disabled or nothing is treated
+	dout << left << setw(10) << "stage" << right << setw(10) << "time,s" << setw(8) << "share";
+	if( PerfCounters::Enabled ) {
+		for(BYTE k=0; k<PerfCounters::Count; k++)
+			if( PerfCounters::IsAvailable(k) )	dout << setw(15) << PerfCounters::Titles[k];
+			else	unavailable += BLANK + string(PerfCounters::Titles[k]);
+	}
+	const bool ipc = PerfCounters::Enabled
+		&& PerfCounters::IsAvailable(PerfCounters::CYCLES) && PerfCounters::IsAvailable(PerfCounters::INSTRUCTIONS);
+	if( ipc )	dout << setw(7) << "IPC";
+	dout << EOL << fixed;
+	for(BYTE i=0; i<Count; i++) {
+		if( !_Totals[i] )	continue;	// stage is not passed, e.g. tokenize by batch decoding
+		dout << left << setw(10) << _Titles[i] << right
+			 << setw(10) << setprecision(3) << _Totals[i] / 1e9
+			 << setw(7) << setprecision(1) << 100. * _Totals[i] / total << PERS;
+		if( PerfCounters::Enabled )
+			for(BYTE k=0; k<PerfCounters::Count; k++)
+				if( PerfCounters::IsAvailable(k) )	dout << setw(15) << _TotalCounts[i][k];
+		if( ipc ) {
+			const ULLONG cycles = _TotalCounts[i][PerfCounters::CYCLES];
+			dout << setw(7) << setprecision(2);
+			if( cycles )	dout << double(_TotalCounts[i][PerfCounters::INSTRUCTIONS]) / cycles;
+			else			dout << '-';
+		}
+		dout << EOL;
+	}
+	dout.unsetf(ios_base::floatfield);
+	dout << setprecision(6);
+	if( unavailable.length() )
+		dout << "performance counters are unavailable:" << unavailable << EOL;
+}
+/************************  end of class Stages ************************/
+
+/************************  class Trace ************************/
+bool	Trace::Enabled = false;
+ULLONG	Trace::_StartTime = 0;
+vector<Trace::Ring*>	Trace::_Rings;
+THREAD_LOCAL Trace::Ring*	Trace::_Local = NULL;
+
+// Adds event to the track of current thread
+//	@name: event's name
+//	return: added event, or NULL if thread has no track
+Trace::Event* Trace::Add(const char* name)
+{
+	Ring* ring = _Local;
+	if( !ring )		return NULL;
+	Event* e;
+	if( ring->Events.size() < RingSize ) {
+		ring->Events.push_back(Event());
+		e = &ring->Events.back();
+	}
+	else
+		e = &ring->Events[ring->Count % RingSize];
+	ring->Count++;
+	e->Time = Timer::Now();
+	e->Dur = 0;
+	e->Val = 0;
+	e->Cat = NULL;
+	strncpy(e->Name, name, TRACE_NAME_LEN - 1);
+	e->Name[TRACE_NAME_LEN - 1] = '\0';
+	return e;
+}
+
+// Enables tracing and sets its start time
+void Trace::Start()
+{
+	Enabled = true;
+	_StartTime = Timer::Now();
+}
+
+// Binds current thread to the track of its role and owner; creates track if it does not exist
+//	@role: role of thread
+//	@key: owner of thread; the threads of different owners are put on different tracks
+void Trace::Attach(const char* role, const void* key)
+{
+	if( !Enabled )	return;
+	USHORT ind = 0;
+	_Local = NULL;
+#ifdef _MULTITHREAD
+	Mutex::Lock(Mutex::TRACE);
+#endif
+	for(vector<Ring*>::const_iterator it=_Rings.begin(); it!=_Rings.end(); it++)
+		if( !strcmp((*it)->Role, role) ) {
+			if( (*it)->Key == key )	{ _Local = *it; break; }
+			ind++;
+		}
+	if( !_Local ) {
+		_Rings.push_back(new Ring(role, key, ind));
+		_Local = _Rings.back();
+	}
+#ifdef _MULTITHREAD
+	Mutex::Unlock(Mutex::TRACE);
+#endif
+}
+
+// Adds span finished now
+//	@cat: category
+//	@name: name
+//	@start: start time in nanoseconds
+void Trace::Complete(const char* cat, const char* name, ULLONG start)
+{
+	Event* e;
+	if( !Enabled || (e = Add(name)) == NULL )	return;
+	e->Dur = e->Time - start;
+	e->Time = start;
+	e->Cat = cat;
+}
+
+// Prints string as JSON string
+//	@file: output file
+//	@str: printed string
+void TraceStr(FILE* file, const char* str)
+{
+	fputc('"', file);
+	for(; *str; str++)
+		if( *str == '"' || *str == '\\' )	fprintf(file, "\\%c", *str);
+		else if( BYTE(*str) < BLANK )		fprintf(file, "\\u%04x", BYTE(*str));
+		else								fputc(*str, file);
+	fputc('"', file);
+}
+
+// Saves recorded events as Chrome trace file and releases them
+//	@fName: file name
+void Trace::Save(const char* fName)
+{
+	FILE* file = fopen(fName, "w");
+	if( !file )		Err(Err::F_OPEN, fName).Throw();
+	ULLONG lost = 0;
+	bool first = true;
+
+	fputs("{\"traceEvents\":[", file);
+	for(size_t i=0; i<_Rings.size(); i++) {
+		const Ring& ring = *_Rings[i];
+		const size_t tid = i + 1;
+		bool single = true;		// true if track is the only one of its role
+
+		for(size_t k=0; k<_Rings.size() && single; k++)
+			single = k == i || strcmp(_Rings[k]->Role, ring.Role);
+		fprintf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%lu,\"args\":{\"name\":\"%s",
+			first ? "" : ",", ULONG(tid), ring.Role);
+		if( !single )	fprintf(file, " %u", ring.Ind + 1);
+		fprintf(file, "\"}},\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":%lu,\"args\":{\"sort_index\":%lu}}",
+			ULONG(tid), ULONG(tid));
+		first = false;
+		// events in order of addition: the oldest kept one is the next to overwrite
+		const size_t cnt = ring.Events.size(),
+			start = ring.Count > cnt ? size_t(ring.Count % cnt) : 0;
+		lost += ring.Count - cnt;
+		for(size_t k=0; k<cnt; k++) {
+			const Event& e = ring.Events[(start + k) % cnt];
+			fputs(",\n{\"name\":", file);
+			TraceStr(file, e.Name);
+			if( e.Cat )
+				fprintf(file, ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%lu}",
+					e.Cat, (e.Time - _StartTime) / 1e3, e.Dur / 1e3, ULONG(tid));
+			else
+				fprintf(file, ",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"tid\":%lu,\"args\":{\"value\":%lld}}",
+					(e.Time - _StartTime) / 1e3, ULONG(tid), e.Val);
+		}
+	}
+	fprintf(file, "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"lost_events\":%llu}}\n", lost);
+	for(size_t i=0; i<_Rings.size(); i++)	delete _Rings[i];
+	_Rings.clear();
+	_Local = NULL;
+	if( fclose(file) )	Err(Err::F_WRITE, fName).Throw();
+}
+/************************  end of class Trace ************************/
+
+/************************  class Memory ************************/
+bool	Memory::Enabled = false;
+const char*	Memory::_Titles[] = {
+	"read", "read-ahead", "spill", "mapped", "write", "line", "zlib", "unzip", "zip", "output" };
+LLONG	Memory::_Sizes[Memory::Count];
+LLONG	Memory::_Peaks[Memory::Count];
+ULONG	Memory::_Allocs[Memory::Count];
+LLONG	Memory::_Size = 0;
+LLONG	Memory::_Peak = 0;
+
+// Accounts allocated or released buffer; thread-safe
+//	@buff: purpose of buffer
+//	@len: length of allocated buffer, or negative length of released one
+void Memory::Account(eBuff buff, LLONG len)
+{
+#ifdef _MULTITHREAD
+	Mutex::Lock(Mutex::MEMORY);
+#endif
+	if( len > 0 ) {
+		_Allocs[buff]++;
+		if( (_Sizes[buff] += len) > _Peaks[buff] )	_Peaks[buff] = _Sizes[buff];
+		if( (_Size += len) > _Peak )				_Peak = _Size;
+	}
+	else {
+		_Sizes[buff] += len;
+		_Size += len;
+	}
+#ifdef _MULTITHREAD
+	Mutex::Unlock(Mutex::MEMORY);
+#endif
+}
+
+// Returns peak resident set size of process in bytes, or 0 if it is unknown
+ULLONG Memory::PeakRSS()
+{
+#ifdef OS_Windows
+	PROCESS_MEMORY_COUNTERS pmc;
+	return GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)) ? pmc.PeakWorkingSetSize : 0;
+#else
+	rusage usage;
+	if( getrusage(RUSAGE_SELF, &usage) )	return 0;
+	#ifdef __APPLE__
+	return ULLONG(usage.ru_maxrss);				// in bytes
+	#else
+	return ULLONG(usage.ru_maxrss) << 10;		// in kilobytes
+	#endif
+#endif
+}
+
+// Prints the high-water marks of buffers and peak resident set size, if accounting is enabled
+void Memory::Print()
+{
+	if( !Enabled )	return;
+	const double mb = 1024 * 1024;
+
+	dout << left << setw(12) << "buffer" << right << setw(8) << "allocs" << setw(10) << "peak,MB" << EOL;
+	dout << fixed << setprecision(1);
+	for(BYTE i=0; i<Count; i++)
+		if( _Allocs[i] )
+			dout << left << setw(12) << _Titles[i] << right
+				 << setw(8) << _Allocs[i] << setw(10) << _Peaks[i] / mb << EOL;
+	dout << left << setw(20) << "all buffers" << right << setw(10) << _Peak / mb << EOL;
+	const ULLONG rss = PeakRSS();
+	dout << left << setw(20) << "peak RSS" << right;
+	if( rss )	dout << setw(10) << rss / mb << EOL;
+	else		dout << setw(10) << '-' << EOL;
+	dout.unsetf(ios_base::floatfield);
+	dout << setprecision(6);
+}
+/************************  end of class Memory ************************/
+
+/************************  class Progress ************************/
+bool	Progress::Enabled = false;
+ULLONG	Progress::_Total = 0;
+ULLONG	Progress::_Read = 0;
+ULLONG	Progress::_Records = 0;
+ULLONG	Progress::_StartTime = 0;
+ULLONG	Progress::_PrintTime = 0;
+bool	Progress::_Unknown = false;
+char	Progress::_Chrom[PROGRESS_NAME_LEN];
+
+// Adds input file
+//	@len: length of file on disk, or -1 if it is unknown
+void Progress::AddInput(LLONG len)
+{
+	if( len < 0 )	_Unknown = true;
+	else			_Total += len;
+}
+
+// Sets current chromosome
+//	@name: chromosome's name
+void Progress::Chrom(const string& name)
+{
+	if( !Enabled )	return;
+	strncpy(_Chrom, name.c_str(), PROGRESS_NAME_LEN - 1);
+	_Chrom[PROGRESS_NAME_LEN - 1] = '\0';
+}
+
+// Prints progress line
+//	@now: current time in nanoseconds
+//	@final: true if input is read completely
+void Progress::Print(ULLONG now, bool final)
+{
+	const double elapsed = (now - _StartTime) / 1e9;
+	const bool known = _Total && !_Unknown && _Read;
+
+	_PrintTime = now;
+	dout << "progress: " << fixed << setprecision(1);
+	if( known )	dout << min(100. * _Read / _Total, 100.) << PERS;
+	else		dout << '-';
+	dout << SepCm << (elapsed ? _Read / 1048576. / elapsed : 0) << " MB/s"
+		 << SepCm << setprecision(0) << (elapsed ? _Records / elapsed : 0) << " records/s";
+	dout.unsetf(ios_base::floatfield);
+	dout << setprecision(6);
+	if( final )
+		Timer::PrintElapsed(", time ", elapsed, false, true);
+	else {
+		if( *_Chrom )	dout << SepCm << _Chrom;
+		if( known )
+			Timer::PrintElapsed(", ETA ", _Read < _Total ? elapsed * (_Total - _Read) / _Read : 0, false, true);
+		else
+			dout << ", ETA -" << EOL;
+	}
+}
+/************************  end of class Progress ************************/
+
 /************************  class CPU_Timer ************************/
 //bool CPU_Timer::Enabled = false;
 //clock_t CPU_Timer::_startTime;
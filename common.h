@@ -16,6 +16,8 @@
 	#include <math.h>
 	#include <dirent.h>
 	#include <stdio.h>
+	#include <sys/mman.h>	// mmap()
+	#include <fcntl.h>		// open()
 #ifdef _MULTITHREAD
 	#include <pthread.h>
 	#define InterlockedExchangeAdd	__sync_fetch_and_add
@@ -35,6 +37,7 @@
 	//typedef off64_t __int64;
 	typedef void*	retThreadValType;
 	#define retThreadValTrue	(void*)1
+	#define THREAD_LOCAL	__thread
 
 	#define rand()	rand_r(&_seed)
 	#define _stricmp strcasecmp	// case-sensitive comparison
@@ -52,6 +55,8 @@
 #elif defined _WIN32
 	#define OS_Windows
 	#include <windows.h>
+	#include <io.h>			// _open(), _write()
+	#include <fcntl.h>		// _O_BINARY
 #ifdef _MULTITHREAD
 	#include <process.h>	    // _beginthread, _endthread
 	#define pthread_t HANDLE
@@ -62,6 +67,7 @@
 	typedef struct __stat64 struct_stat64;
 	typedef UINT	retThreadValType;
 	#define retThreadValTrue	1
+	#define THREAD_LOCAL	__declspec(thread)
 
 	#define atol _atoi64
 	#define isnan _isnan
@@ -489,10 +495,14 @@ public:
 		F_WRITE,	// file write error
 #ifndef _FQSTATN
 		TF_FIELD,	// TabFile: number of fields is less than expected
+		TF_NUMB,	// TabFile: field is not a valid integer
 		//TF_SPEC,
 		TF_EMPTY,	// TabFile: none item (should be specified)
 		BP_BADEND,	// bed: start is is equal or more than end
 		BP_NEGPOS,	// bed: negative position
+#ifdef _WIGREG
+		TR_INVALID,	// binary track: invalid format
+#endif
 #ifdef _BEDR_EXT
 		BR_RNAME,	// bed read: wrong read name format
 #endif
@@ -643,6 +653,9 @@ public:
 	// Gets real size of zipped file  or -1 if file cannot open; limited by UINT
 	static LLONG UncomressSize	(const char*);
 
+	// Returns true if name denotes standard input
+	inline static bool IsStdIn(const string& name) { return !_stricmp(name.c_str(), "stdin"); }
+
 	// Returns true if file exists
 	inline static bool IsFileExist	 (const char* name) { return IsExist(name, S_IFREG); }
 	
@@ -751,7 +764,10 @@ public:
 	// Returns the name ended by slash without checking the name
 	static string const MakePath(const string& name);
 
-#ifndef _WIGREG
+	// Returns true if the name is absolute path
+	//	@name: file or directory name
+	static bool IsAbsPath(const string& name);
+
 	// Fills external vector of strings by file's names found in given directory
 	// Implementation depends of OS.
 	//	@files: external vector of strings that should be filled by file's names
@@ -761,7 +777,6 @@ public:
 	//	otherwise only one (any)
 	//	return: true if files with given extention are found
 	static bool GetFiles	(vector<string>& files, const string& dirName, const string& fileExt, bool all = true);
-#endif	// _WIGREG
 
 //	static inline void	Delete		(const char* fname) {
 //#ifdef OS_Windows
@@ -853,21 +868,39 @@ public:
 class Timer
 {
 private:
-	time_t	_startTime;
+	ULLONG	_startTime;	// in nanoseconds
 	bool	_enabled;	// True if local timing is enabled
 	static clock_t	_StartCPUClock;
 
 	// Prints elapsed time interval
 	//	@title: string printed before time output
-	//	@elapsed: elapsed time interval
+	//	@elapsed: elapsed time interval in seconds
 	//	@parentheses: if true then output time in parentheses
 	//	@isCarrgReturn: if true then ended output by EOL
-	static void PrintElapsed(const char *title, long elapsed, bool parentheses, bool isCarriageReturn);
+	static void PrintElapsed(const char *title, double elapsed, bool parentheses, bool isCarriageReturn);
+
+	friend class Progress;
 
 public:
 	// True if total timing is enabled
 	static bool		Enabled;
 
+	// Returns monotonic time in nanoseconds
+	static inline ULLONG Now()
+	{
+#ifdef OS_Windows
+		static LARGE_INTEGER freq;
+		LARGE_INTEGER cnt;
+		if( !freq.QuadPart )	QueryPerformanceFrequency(&freq);
+		QueryPerformanceCounter(&cnt);
+		return ULLONG(cnt.QuadPart / double(freq.QuadPart) * 1e9);
+#else
+		timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return ULLONG(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+#endif
+	}
+
 	// Starts enabled CPU timer, if it is enabled
 	static inline void StartCPU()	{ if( Enabled ) _StartCPUClock = clock(); }
 	
@@ -880,7 +913,7 @@ public:
 	Timer(bool enabled = true)	{ _enabled = enabled ? Enabled : false; Start(); }
 	
 	// Restarts timer, if timing is enabled
-	inline void Start()				{ if( _enabled ) time( &_startTime ); }
+	inline void Start()				{ if( _enabled ) _startTime = Now(); }
 
 	// Stops enabled timer and print elapsed time with title
 	//	@title: string printed before time output
@@ -898,19 +931,344 @@ public:
 	inline bool IsEnabled() const { return _enabled; }
 };
 
+// 'PerfCounters' reads the performance counters of current thread by perf_event_open(), if they are enabled.
+// Counters are read by a single call as a group; unavailable counters are skipped.
+// Kernel's work is not counted. Counters are available under Linux only.
+class PerfCounters
+{
+public:
+	enum eCounter { CYCLES, INSTRUCTIONS, BRANCH_MISSES, CACHE_MISSES, PAGE_FAULTS };
+	static const BYTE Count = PAGE_FAULTS + 1;
+	static const char*	Titles[];
+
+	// True if counters are enabled
+	static bool	Enabled;
+
+private:
+	static bool	_Available[];	// true if counter is opened at least once
+
+	int		_fds[Count];	// descriptors of counters, or -1 if counter is unavailable
+	int		_leader;		// descriptor of group leader, or -1 if no counter is available
+	char	_inds[Count];	// indexes of counters in group's values, or -1 if counter is unavailable
+	BYTE	_cnt;			// number of opened counters
+
+public:
+	// Opens counters of current thread, if they are enabled
+	PerfCounters();
+
+	~PerfCounters();
+
+	// Returns true if at least one counter is opened
+	inline bool IsOpened() const	{ return _leader >= 0; }
+
+	// Returns true if counter has been opened at least once
+	static inline bool IsAvailable(BYTE counter)	{ return _Available[counter]; }
+
+	// Reads the values of counters; values of unavailable counters are 0
+	//	@vals: array of values
+	void Read(ULLONG* vals) const;
+};
+
+// 'Stages' accumulates the time spent by the stages of treatment if timing is enabled.
+// Time is accounted exclusively: the stage started inside another one suspends it.
+// Line stages alternate for each line, and reading the clock at each switch costs more than they do.
+// So they are measured exactly for every 64th line only,
+// and the time of the rest lines is distributed in proportion to the measured one.
+// If performance counters are enabled, they are accounted in the same way as time,
+// and the time of their reading is excluded.
+// Each thread accounts its stages by its own instance created in the thread,
+// which adds its times to the totals when it is closed.
+// In multithread mode the totals are the sums over threads.
+class Stages
+{
+public:
+	enum eStage {
+		NONE,		// time outside of the stages
+		READ,		// reading and decompression of input
+		TOKENIZE,	// splitting input into lines and fields
+		PARSE,		// conversion of fields
+		REGULATE,	// treatment of records
+		OUTPUT		// formatting, compression and writing of output
+	};
+	static const BYTE Count = OUTPUT + 1;
+
+private:
+	static const UINT SampleMask = 0x3F;	// mask of line counter to measure every 64th line
+
+	static const char*	_Titles[];
+	static ULLONG	_Totals[];
+	static ULLONG	_TotalCounts[][PerfCounters::Count];
+	static THREAD_LOCAL Stages*	_Local;	// the instance of current thread
+
+	ULLONG	_times[Count];
+	ULLONG	_rest;		// not measured time of line stages
+	ULLONG	_start;		// time of the last clock reading
+	UINT	_lineCnt;	// number of started lines
+	eStage	_stage;		// current stage
+	bool	_sampled;	// true if current line is measured
+	bool	_exact;		// true if the time since the last clock reading belongs to current stage
+	PerfCounters*	_perf;	// performance counters, or NULL if they are disabled
+	ULLONG	_counts[Count][PerfCounters::Count];	// counters of stages
+	ULLONG	_restCounts[PerfCounters::Count];		// not measured counters of line stages
+	ULLONG	_lastCounts[PerfCounters::Count];		// counters at the last reading
+
+	// Returns true if stage is repeated for each line
+	static inline bool IsLineStage(eStage stage) { return stage >= TOKENIZE && stage <= REGULATE; }
+
+	// Adds the time and counters since the last reading to finished stage
+	//	@stage: finished stage
+	void MeasurePerf(eStage stage);
+
+	// Adds the time since the last clock reading to finished stage
+	//	@stage: finished stage
+	inline void Measure(eStage stage)
+	{
+		if( _perf )		{ MeasurePerf(stage); return; }
+		const ULLONG now = Timer::Now();
+		if( _exact )	_times[stage] += now - _start;
+		else			_rest += now - _start;
+		_start = now;
+		_exact = true;
+	}
+
+public:
+	// Creates and starts accounting of current thread, if timing is enabled
+	Stages();
+
+	inline ~Stages()	{ Close(); }
+
+	// Stops accounting of current thread and adds its times to the totals
+	void Close();
+
+	// Switches the accounting of current thread to given stage.
+	// Switching to TOKENIZE from any stage except READ starts the next line.
+	//	@stage: started stage
+	//	@exact: true if previous stage is measured regardless of line sampling, e.g. for batch of lines
+	//	return: previous stage
+	static inline eStage Switch(eStage stage, bool exact = false)
+	{
+		Stages* local = _Local;
+		if( !local )	return NONE;
+		const eStage prev = local->_stage;
+		const bool sampled = local->_sampled;
+
+		if( stage == TOKENIZE && prev != READ )
+			local->_sampled = !(++local->_lineCnt & SampleMask);
+		local->_stage = stage;
+		if( exact || sampled || local->_sampled || !IsLineStage(prev) || !IsLineStage(stage) )
+			local->Measure(prev);
+		else
+			local->_exact = false;
+		return prev;
+	}
+
+	// Prints the totals of stages
+	static void Print();
+};
+
+#define TRACE_NAME_LEN	32	// maximum length of trace event's name including terminating null
+
+// 'Trace' records the spans of treatment and the counters in Chrome trace event format, if tracing is enabled.
+// Each thread adds events to the ring of its track without locking,
+// so the oldest events of track are lost if its ring is overflowed.
+// The threads performing the same role for the same owner one after another share the track.
+class Trace
+{
+private:
+	// 'Event' is a span or a counter's value
+	struct Event {
+		ULLONG	Time;		// start time in nanoseconds
+		ULLONG	Dur;		// span's duration in nanoseconds
+		LLONG	Val;		// counter's value
+		const char*	Cat;	// span's category, or NULL for counter
+		char	Name[TRACE_NAME_LEN];
+	};
+
+	// 'Ring' keeps the last events of track
+	struct Ring {
+		const char*	Role;	// role of the track's threads
+		const void*	Key;	// owner of the track's threads
+		USHORT	Ind;		// index among the tracks of the same role
+		ULLONG	Count;		// number of added events
+		vector<Event>	Events;
+
+		inline Ring(const char* role, const void* key, USHORT ind)
+			: Role(role), Key(key), Ind(ind), Count(0) {}
+	};
+
+	static const size_t RingSize = 8192;	// maximum number of events kept by track
+
+	static vector<Ring*>	_Rings;
+	static ULLONG	_StartTime;
+	static THREAD_LOCAL Ring*	_Local;	// the track of current thread
+
+	// Adds event to the track of current thread
+	//	@name: event's name
+	//	return: added event, or NULL if thread has no track
+	static Event* Add(const char* name);
+
+public:
+	// True if tracing is enabled
+	static bool	Enabled;
+
+	// 'Span' adds the span of its lifetime to the track of current thread
+	class Span
+	{
+	private:
+		ULLONG		_start;
+		const char*	_cat;
+		const char*	_name;
+	public:
+		// Starts span
+		//	@cat: category
+		//	@name: name; should exist until span is finished
+		inline Span(const char* cat, const char* name)
+			: _start(Enabled ? Timer::Now() : 0), _cat(cat), _name(name) {}
+
+		inline ~Span()	{ if( _start )	Complete(_cat, _name, _start); }
+	};
+
+	// Enables tracing and sets its start time
+	static void Start();
+
+	// Binds current thread to the track of its role and owner; creates track if it does not exist
+	//	@role: role of thread
+	//	@key: owner of thread; the threads of different owners are put on different tracks
+	static void Attach(const char* role, const void* key);
+
+	// Adds span finished now
+	//	@cat: category
+	//	@name: name
+	//	@start: start time in nanoseconds
+	static void Complete(const char* cat, const char* name, ULLONG start);
+
+	// Adds the value of counter
+	//	@name: counter's name
+	//	@val: value
+	static inline void Counter(const char* name, LLONG val)
+	{
+		Event* e;
+		if( Enabled && (e = Add(name)) != NULL )	e->Val = val;
+	}
+
+	// Saves recorded events as Chrome trace file and releases them
+	//	@fName: file name
+	static void Save(const char* fName);
+};
+
+// 'Memory' accounts the memory of buffers by their purpose, if accounting is enabled,
+// and reports the high-water marks of buffers along with the peak resident set size of process.
+class Memory
+{
+public:
+	enum eBuff {		// purpose of buffer
+		READ,			// basic read buffer of text file
+		READ_AHEAD,		// pair of read-ahead buffers of text file
+		SPILL,			// spill buffer of the records longer than read buffer
+		MAPPED,			// mapped window of text file
+		WRITE,			// basic write buffer of text file
+		LINE,			// line write buffer of text file
+		ZLIB,			// internal buffers of zlib stream; estimated
+		UNZIP,			// compressed batch and inflated chunks of multi-member gzip file
+		ZIP,			// uncompressed batches and deflated parts of BGZF file
+		OUTPUT			// output buffer of wiggle writer
+	};
+	static const BYTE Count = OUTPUT + 1;
+
+private:
+	static const char*	_Titles[];
+	static LLONG	_Sizes[];		// current size of buffers of each purpose
+	static LLONG	_Peaks[];		// high-water mark of buffers of each purpose
+	static ULONG	_Allocs[];		// number of allocations of each purpose
+	static LLONG	_Size;			// current size of all buffers
+	static LLONG	_Peak;			// high-water mark of all buffers
+
+public:
+	// True if accounting is enabled
+	static bool	Enabled;
+
+	// Accounts allocated or released buffer
+	//	@buff: purpose of buffer
+	//	@len: length of allocated buffer, or negative length of released one
+	static inline void Add(eBuff buff, LLONG len)	{ if( Enabled && len )	Account(buff, len); }
+
+	// Accounts allocated or released buffer; thread-safe
+	//	@buff: purpose of buffer
+	//	@len: length of allocated buffer, or negative length of released one
+	static void Account(eBuff buff, LLONG len);
+
+	// Returns peak resident set size of process in bytes, or 0 if it is unknown
+	static ULLONG PeakRSS();
+
+	// Prints the high-water marks of buffers and peak resident set size, if accounting is enabled
+	static void Print();
+};
+
+#define PROGRESS_INTERVAL	2		// interval between progress lines in seconds
+#define PROGRESS_NAME_LEN	32		// maximum length of chromosome's name in progress line including terminating null
+
+// 'Progress' periodically prints the progress of input reading, if it is enabled.
+// Input files add the read chars and records after each read block, so reporting costs nothing per line.
+// The read chars of zipped file are the compressed ones, so the percent is consumed share of file on disk.
+class Progress
+{
+private:
+	static ULLONG	_Total;			// total length of input files, or 0 if it is unknown
+	static ULLONG	_Read;			// number of read chars
+	static ULLONG	_Records;		// number of read records
+	static ULLONG	_StartTime;		// start time in nanoseconds
+	static ULLONG	_PrintTime;		// time of the last printed line in nanoseconds
+	static bool		_Unknown;		// true if the length of some input is unknown
+	static char		_Chrom[];		// current chromosome's name
+
+	// Prints progress line
+	//	@now: current time in nanoseconds
+	//	@final: true if input is read completely
+	static void Print(ULLONG now, bool final);
+
+public:
+	// True if progress reporting is enabled
+	static bool	Enabled;
+
+	// Sets start time
+	static inline void Start()	{ _StartTime = _PrintTime = Timer::Now(); }
+
+	// Adds input file
+	//	@len: length of file on disk, or -1 if it is unknown
+	static void AddInput(LLONG len);
+
+	// Adds read chars and records and prints progress line if interval is passed
+	//	@len: number of read chars
+	//	@recCnt: number of read records
+	static inline void Add(ULLONG len, ULONG recCnt)
+	{
+		_Read += len;
+		_Records += recCnt;
+		const ULLONG now = Timer::Now();
+		if( now - _PrintTime >= PROGRESS_INTERVAL * 1000000000ULL )	Print(now, false);
+	}
+
+	// Sets current chromosome
+	//	@name: chromosome's name
+	static void Chrom(const string& name);
+
+	// Prints the final progress line, if reporting is enabled
+	static inline void Finish()	{ if( Enabled )	Print(Timer::Now(), true); }
+};
+
 #ifdef _MULTITHREAD
-static class Mutex
+class Mutex
 {
 private:
-	static const BYTE Count = 2;
+	static const BYTE Count = 5;
 	static pthread_mutex_t	_mutexes[];
 public:
-	enum eType { OUTPUT, WR_FILE };
+	enum eType { OUTPUT, WR_FILE, JOBS, TRACE, MEMORY };
 	static void Init();
 	static void Finalize();
 	static void Lock(const eType type);
 	static void Unlock(const eType type);
-} mutex;
+};
 
 class Thread
 {
@@ -1,5 +1,6 @@
 #define OPT_DESCF_TSHIFT 3	// number of TABs before decsription field in Options::PrintUsage()
 
 #define	_WIGREG
+#define _MULTITHREAD
 //#define NO_ZLIB
 //#define dout cout
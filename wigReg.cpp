@@ -10,13 +10,18 @@
  */
 
 #include "def.h"
+#include <algorithm>	// sort(); should be included before common.h
+#include <list>
 #include "common.h"
 #include "TxtFile.h"
+#include "BigWigFile.h"
 #include <fstream>
 #include "wigReg.h"
 
 using namespace std;
 
+#define DATA_BATCH	4096	// number of data lines decoded at once
+
 const string Product::Title = "wigReg";
 const string Product::Version = "1.0";
 const string Product::Descr = "Regulates wiggle format from MACS and PeakFanger";
@@ -36,6 +41,8 @@ const BYTE	Options::_GroupCount = oOPTION + 1;
 
 enum eOptProg	{ oPR, oMACS, oAUTO };
 const char* ProgVals [] = { "PR", "MACS", "AUTO" };
+const char* FormatVals [] = { "WIG", "BW", "BEDGRAPH", "BIN" };
+const char* FormatExts [] = { ".wig", ".bw", ".bedgraph", ".wgb" };	// output extensions in batch mode
 
 const char* ForMACS = "Ignored for the wiggle from MACS";
 
@@ -47,7 +54,27 @@ Options::Option Options::_Options [] = {
 	{ 'f',"frag-len",0,	tINT,	oOPTION, 200, 50, 400, NULL, "length of fragment.", ForMACS },
 	{ 's',"space",	 0, tINT,	oOPTION, 10, 1, 100, NULL,
 	"resolution: minimal span in bp from which intervals will be saved.\n", ForMACS },
-	{ 't', "time",	 0,	tENUM,	oOPTION, FALSE,	vUNDEF, 2, NULL, "print run time", NULL },
+	{ 'm',"merge",	 0,	tNAME,	oOPTION, vUNDEF, 0, 0, NULL,
+	"minus strand's wiggle from PeakRanger merged with the input one of plus strand", NULL },
+	{ HPH,"signed",	 0,	tENUM,	oOPTION, FALSE,	vUNDEF, 2, NULL,
+	"subtract merged minus strand's values instead of adding them", NULL },
+	{ 'o',"format",	 0,	tENUM,	oOPTION, float(fWIG), 0, 4, (char*)FormatVals,
+	"format of output: wiggle, bigWig, bedGraph or binary track", NULL },
+	{ 'c',"chrom-sizes",0,tNAME,oOPTION, vUNDEF, 0, 0, NULL,
+	"chrom.sizes file: chromosome names and lengths.\nRequired for bigWig output", NULL },
+	{ 'b',"batch",	 0,	tENUM,	oOPTION, FALSE,	vUNDEF, 2, NULL,
+	"batch mode: input is a directory of wiggles or a list of input and output names,\noutput is a directory. Files are treated by --threads workers", NULL },
+	{ HPH,"threads", 0,	tINT,	oOPTION, 1, 1, 64, NULL,
+	"number of threads regulating chromosomes in parallel,\nor treating files in batch mode", NULL },
+	{ HPH,"stats",	 0,	tNAME,	oOPTION, vUNDEF, 0, 0, NULL, "save run statistics to file in JSON format", NULL },
+	{ HPH,"trace",	 0,	tNAME,	oOPTION, vUNDEF, 0, 0, NULL, "save timeline of treatment to file in Chrome trace format", NULL },
+	{ HPH,"mem",	 0,	tENUM,	oOPTION, FALSE,	vUNDEF, 2, NULL, "print peak memory of process and high-water marks of buffers", NULL },
+	{ HPH,"mem-limit",0,tINT,	oOPTION, vUNDEF, 4, 65536, NULL,
+	"size the buffers of input and output to fit the memory limit in MB", NULL },
+	{ HPH,"perf",	 0,	tENUM,	oOPTION, FALSE,	vUNDEF, 2, NULL, "print hardware performance counters of stages.\nImplies -t", NULL },
+	{ HPH,"progress",0,	tENUM,	oOPTION, FALSE,	vUNDEF, 2, NULL,
+	"print progress of reading input, throughput, current chromosome\nand estimated remaining time every 2 seconds", NULL },
+	{ 't', "time",	 0,	tENUM,	oOPTION, FALSE,	vUNDEF, 2, NULL, "print run time, and time of chromosomes and stages", NULL },
 	{ 'h', "help",	 0,	tHELP,	oOPTION, vUNDEF, vUNDEF, 0, NULL, "print usage information", NULL }
 
 };
@@ -55,7 +82,7 @@ Options::Option Options::_Options [] = {
 const BYTE	Options::_OptCount = oHELP + 1;
 const BYTE	Options::_UsageCount = 1;
 const Options::Usage Options::_Usages[] = {
-	{ vUNDEF, "input.wig stdout|output.wig", true, NULL}
+	{ vUNDEF, "stdin|input.wig stdout|output.wig", true, NULL}
 };
 
 ofstream outfile;				// file ostream duplicated cout; inizialised by file in code
@@ -63,6 +90,23 @@ ofstream outfile;				// file ostream duplicated cout; inizialised by file in cod
 
 /*****************************************/
 
+// main() is excluded to link wigReg's classes to microbenchmark
+#ifndef _NO_MAIN
+// Sizes the buffers of input and output to fit the memory limit
+//	@limit: memory limit in MB
+void SetMemLimit(UINT limit)
+{
+	const ULLONG len = ULLONG(limit) << 20;
+
+	// output takes 1/16 of the limit
+	WigWriter::BuffLen = min(WigWriter::BuffLen, size_t(len >> 4));
+	// input takes no more than twice the basic buffer: read-ahead pair and zlib buffers
+	// for zipped file, read-ahead pair for plain one; the length is aligned to 64 KB, but not less
+	ULLONG inLen = len > WigWriter::BuffLen ? ((len - WigWriter::BuffLen) >> 1) & ~0xFFFFULL : 0;
+	if( !inLen )	inLen = 0x10000;
+	TxtFile::BuffLen = UINT(min(ULLONG(TxtFile::BuffLen), inLen));	// cast after clamping
+}
+
 int main(int argc, char* argv[])
 {
 	if (argc < 2)	return Options::PrintUsage(false);			// output tip
@@ -73,25 +117,68 @@ int main(int argc, char* argv[])
 	if( fileInd == argc-1 )		// check if output file is setting
 		Err(Err::MISSED, NULL, "output.wig").Throw(false);
 
-	Timer::Enabled = Options::GetBVal(oTIME);
+	Memory::Enabled = Options::GetBVal(oMEM);
+	// files of batch are read in parallel, so their progress is not reported
+	Progress::Enabled = Options::GetBVal(oPROGRESS) && !Options::GetBVal(oBATCH);
+	if( Options::GetIVal(oMEMLIMIT) != UINT(vUNDEF) )	SetMemLimit(Options::GetIVal(oMEMLIMIT));
+	PerfCounters::Enabled = Options::GetBVal(oPERF);
+	Timer::Enabled = Options::GetBVal(oTIME) || PerfCounters::Enabled;
+	const char* statsName = Options::GetSVal(oSTATS);
+	const char* traceName = Options::GetSVal(oTRACE);
+	WigStats::Enabled = statsName != NULL;
 	Timer timer;
-	try { WigReg wig(*(argv + fileInd), *(argv + fileInd + 1));	}
+	Stages stages;
+#ifdef _MULTITHREAD
+	Mutex::Init();
+#endif
+	if( traceName ) {
+		Trace::Start();
+		Trace::Attach("main", NULL);
+	}
+	if( Progress::Enabled )		Progress::Start();
+	try {
+		if( Options::GetBVal(oBATCH) ) {
+			WigBatch batch(*(argv + fileInd), *(argv + fileInd + 1), Options::GetIVal(oTHREADS));
+			ret = batch.ErrorCount() > 0;
+			if( statsName )		batch.SaveStats(statsName);
+		}
+		else {
+			WigReg wig(*(argv + fileInd), *(argv + fileInd + 1), Options::GetIVal(oTHREADS));
+			Progress::Finish();
+			if( statsName )		wig.Stats().Save(statsName);
+			if( Timer::Enabled )	wig.Stats().PrintTimes(dout);
+		}
+	}
 	catch(Err &e)				{ ret = 1;	cout << e.what() << EOL; }
 	catch(const exception &e)	{ ret = 1;	cout << e.what() << EOL; }
 	catch(...)					{ ret = 1;	cout << "Unregistered error\n"; }
+	if( traceName )
+		try { Trace::Save(traceName); }
+		catch(Err &e)	{ ret = 1;	cout << e.what() << EOL; }
+#ifdef _MULTITHREAD
+	Mutex::Finalize();
+#endif
+	stages.Close();
+	Stages::Print();
+	Memory::Print();
 	timer.Stop(true);
 	return ret;
 }
+#endif	// _NO_MAIN
 
 /************************ class Wig ************************/
 
 #define DQUOT	'"'
+#define FIXED_MIN_CNT	8	// minimum number of regular records output as fixedStep block
 const char* kyeTrack	= "track type=";
 const char* kyeWiggle	= "wiggle_0";
+const char* keyBedGraph	= "bedGraph";
 const char* keyStep		= "variableStep";
 const char* keyFixStep	= "fixedStep";
 const char* keyChrom	= "chrom=";
 const char* keySpan		= "span=";
+const char* keyStart	= "start=";
+const char* keyStepLen	= "step=";
 const char* keyName		= "name=";
 const char* keyDescr	= "description=";
 const char* keySpace	= "space=";
@@ -134,152 +221,1302 @@ bool SetProg(const char* line, BYTE* prog)
 	return true;
 }
 
+// Returns current line as null-terminated string.
+// Lines of mapped file are not null-terminated, so non-data lines are copied.
+//	@file: file with current line
+//	@line: current line
+//	@str: string to keep the line
+//	return: pointer to the null-terminated line
+inline const char* LineStr(const TabFile& file, const char* line, string& str)
+{
+	str.assign(line, file.LineLength());
+	return str.c_str();
+}
+
+// Reads comment and definition lines
+//	@file: wiggle
+//	@fName: file name
+//	@prog: point to variable to set a program-source value
+//	@sLine: string to keep definition line
+//	return: pointer to definition line after track type key, or NULL if there are comment lines only
+const char* ReadDef(TabFile& file, const char* fName, BYTE* prog, string& sLine)
+{
+	const char* line;
+	size_t len;
+
+	// the length of input is unknown in advance, so emptiness is checked by the first line
+	if( (line = file.GetLine()) == NULL )
+		Err(Err::TF_EMPTY, fName, sRecords).Throw();
+	// comment lines: typical at PeakRenger wiggle
+	for(; line && line[0] == '/'; line = file.GetLine())
+		SetProg(LineStr(file, line, sLine), prog);
+	if( !line )		return NULL;
+	// definition line
+	line = CheckSpec(LineStr(file, line, sLine), kyeTrack, file);	// check track type key
+	len = strchr(line, BLANK) - line;			// the length of wiggle type in definition
+	if( strncmp(line, kyeWiggle, len) )			// not a wiggle_0.  use _stricmp ?
+		file.ThrowExcept("type '" + string(line, len) + "' does not supported");
+	if( KeyStr(line, progSpec) )
+		Err("is " + string(progSpec) + " already", fName).Throw();
+	if( !SetProg(line, prog) )
+		Err("can not to recognize a "+progTip, fName).Throw();
+	return line;
+}
+
 // Replaces file name and correct description
 void WigReg::CorrectDef(const char* line, const char* fName, BYTE space)
 {
-	_outFile << kyeTrack << BLANK << keyName
-			 << DQUOT << FS::ShortFileName(fName) << DQUOT;
+	_out.Str(kyeTrack);
+	if( _out.Format() == fBG )	_out.Str(keyBedGraph);
+	_out.Char(BLANK);	_out.Str(keyName);
+	_out.Char(DQUOT);	_out.Str(FS::ShortFileName(fName));	_out.Char(DQUOT);
 	const char* sstr = KeyStr(line, keyDescr);
 	if( sstr ) {	// description exists
 		const char* endDescr = strchr(sstr+1, DQUOT);	// str after end of descr
-		_outFile<< BLANK << keyDescr
-				<< string(sstr, endDescr-sstr)		// descr without last quote	
-				<< SepCl << progSpec			// ': regulated'
-				<< BLANK << keySpace << BSTR(space)	// space
-				<< endDescr;						// str after last quote
+		_out.Char(BLANK);	_out.Str(keyDescr);
+		_out.Str(sstr, endDescr-sstr);		// descr without last quote
+		_out.Str(SepCl);	_out.Str(progSpec);	// ': regulated'
+		_out.Char(BLANK);	_out.Str(keySpace);	_out.Int(space);	// space
+		_out.Str(endDescr);					// str after last quote
 	}
 	else {			// description doesn't exist
-		_outFile<< BLANK << keyDescr
-				<< DQUOT << progSpec << BLANK << keySpace << BSTR(space) << DQUOT;	// descr
+		_out.Char(BLANK);	_out.Str(keyDescr);	// descr
+		_out.Char(DQUOT);	_out.Str(progSpec);
+		_out.Char(BLANK);	_out.Str(keySpace);	_out.Int(space);	_out.Char(DQUOT);
 		sstr = strrchr(line, DQUOT);
 		if( sstr && strlen(line) > size_t(sstr - line) )
-			_outFile << ++sstr;						// str after last quote
+			_out.Str(++sstr);				// str after last quote
 	}
-	_outFile << EOL;
+	_out.Char(EOL);
 }
 
-WigReg::WigReg(const char* inFileName, const char* outFileName) : _empty(true)
+// Regulates wiggle or outputs binary track in given format
+//	@inFileName: input file name or "stdin"
+//	@outFileName: output file name or "stdout"
+//	@threadCnt: number of regulating threads
+WigReg::WigReg(const char* inFileName, const char* outFileName, BYTE threadCnt, TxtBuffers* buffers)
+	: _out(eFormat(Options::GetIVal(oFORMAT))), _lineCnt(0), _chromPos(0), _chromTime(Timer::Now())
 {
-	TabFile file(FS::CheckedFileName(inFileName), TxtFile::READ, 2, 2, '\0', NULL, true, true, false);
-	if( !file.Length() )
-		Err(Err::TF_EMPTY, inFileName, sRecords).Throw();
+	_stats.InName = inFileName;
+	_stats.OutName = outFileName;
+	if( Options::GetSVal(oMERGE) )
+		Merge(inFileName, Options::GetSVal(oMERGE), outFileName, threadCnt);
+	else if( !FS::IsStdIn(inFileName) && TrackReader::IsTrack(FS::CheckedFileName(inFileName)) ) {
+		TrackReader track(inFileName);
+		_out.Open(outFileName, threadCnt, Options::GetSVal(oCHROM_SIZES));
+		Print(track, outFileName);
+		_stats.InBytes = _stats.InZipBytes = FS::Size(inFileName);
+	}
+	else
+		Regulate(inFileName, outFileName, threadCnt, buffers);
+	if( !_out.Close() )
+		Err(Err::F_WRITE, outFileName).Throw();
+	_stats.OutLines = _out.LineCount();
+	if( _stricmp(outFileName, "stdout") )
+		_stats.OutFileBytes = FS::Size(outFileName);
+	_stats.OutBytes = _out.IsBinary() ? _stats.OutFileBytes : _out.WrittenLength();
+}
 
-	// set outstream
-	if( _stricmp(outFileName, "stdout") ) {
-		_outFile.open (outFileName, ios_base::out | ios_base::trunc );
-		_initStream = cout.rdbuf(_outFile.rdbuf());
+// Adds the input length and time of current chromosome and starts the next one
+//	@cName: current chromosome's name
+//	@stats: current chromosome's counters
+//	@pos: current input position, or 0 if it is unknown
+void WigReg::EndChromInput(const string& cName, ChromStats& stats, ULLONG pos)
+{
+	const ULLONG now = Timer::Now();
+
+	Trace::Complete("chrom", cName.c_str(), _chromTime);
+	if( pos )	stats.InBytes += pos - _chromPos;
+	stats.Time += now - _chromTime;
+	_chromPos = pos;
+	_chromTime = now;
+}
+
+// Outputs the last record of chromosome and keeps its counters
+//	@reg: regulator
+//	@cName: chromosome's name
+//	@pos: current input position, or 0 if it is unknown
+void WigReg::CloseChrom(ChromReg& reg, const string& cName, ULLONG pos)
+{
+	reg.Close();
+	EndChromInput(cName, reg.Stats(), pos);
+	_stats.AddChrom(cName, reg.Stats());
+	reg.Stats().Clear();
+}
+
+// Outputs records of binary track
+//	@track: opened binary track
+//	@outFileName: output file name or "stdout"
+void WigReg::Print(TrackReader& track, const char* outFileName)
+{
+	TrackRecord rec;
+	// records are regulated already, so they are output the same way as regulated ones
+	ChromReg reg(_out, false, Options::GetIVal(oSPACE), Options::GetIVal(oFRAG_LEN));
+
+	// binary track does not keep definition line
+	if( _stricmp(outFileName, "stdout") && !_out.IsBinary() )
+		CorrectDef(kyeTrack, outFileName, Options::GetIVal(oSPACE));
+	for(size_t i=0; i<track.ChromCount(); i++) {
+		const string& cName = track.ChromName(i);
+		_out.Chrom(cName);
+		reg.Declare((string(keyStep) + BLANK + keyChrom + cName).c_str());
+		for(track.SetChrom(i); track.NextRecord(rec); )
+			reg.AddRecord(rec.Pos, rec.Span, rec.Val);
+		_lineCnt += ULONG(track.RecordCount(i));
+		CloseChrom(reg, cName, 0);
 	}
-	else 
-		_initStream = NULL;
+	_stats.InLines = _lineCnt;
+}
+
+// Regulates wiggle
+//	@inFileName: input file name or "stdin"
+//	@outFileName: output file name or "stdout"
+//	@threadCnt: number of regulating threads
+//	@buffers: owner of reused read buffers, or NULL
+void WigReg::Regulate(const char* inFileName, const char* outFileName, BYTE threadCnt, TxtBuffers* buffers)
+{
+	TabFile file(inFileName, TxtFile::READ, 2, 2, '\0', NULL, true, true, false, true, threadCnt, buffers);
+	file.TrackProgress();
+
+	// set output
+	const bool toFile = _stricmp(outFileName, "stdout") != 0;
+	_out.Open(outFileName, threadCnt, Options::GetSVal(oCHROM_SIZES));
 
-	chrid cID = Chrom::UnID;	// current readed chromosome
 	const char* line;			// current readed line
-	const char* defLine = NULL;	// definition line
-	const char* sSpan;			// pointer to the substring - span value
-	chrlen	pos, newPos = 0,	// current line's, new line's positions
-			startPos = 0,		// current writing region's position
-			posDiff,
-			spanCnt = 1,		// current span counter (for the same values); for MACS only
-			prevSpanCnt = 0,	// previous span count: needs to unit lines
-								// with different values but with the same span;  for MACS only
-			span,				// current declarative span
-			prevSpan,			// previous declarative span; for PR only
+	string	sLine;				// current non-data line
+	string	defLine;			// postponed definition line
+	const char* sName;			// pointer to the substring - chromosome's name
+	string	cName;				// current chromosome's name
+	chrlen	len, pos[DATA_BATCH],	// pos: data lines' positions
 			fragSize = Options::GetIVal(oFRAG_LEN);
-	wigval	val, newVal = 0;	// current, new readed values
-	bool firstLine = true;
+	wigval	vals[DATA_BATCH];	// data lines' values
+	ULONG	i, cnt;				// number of decoded data lines
+	bool	declared = false;	// true if at least one declaration line is readed
 	BYTE	prog = Options::GetIVal(oPROGR),
 			space = Options::GetIVal(oSPACE);
 
 	if(space > 1)		fragSize = AlignPos(fragSize, space, 0);
 
-	while( line = file.GetLine() )	{
-		if( firstLine )
-			if( line[0] == '/' )		// comment line: typical at PeakRenger wiggle
-				SetProg(line, &prog);
-			else {						// definition line
-				line = CheckSpec(line, kyeTrack, file);	// check track type key
-				span = strchr(line, BLANK) - line;		// temp using: the length of wiggle type in definition
-				if( strncmp(line, kyeWiggle, span) )	// not a wiggle_0.  use _stricmp ?
-					file.ThrowExcept("type '" + string(line, span) + "' does not supported");
-				if( KeyStr(line, progSpec) )
-					Err("is " + string(progSpec) + " already", inFileName).Throw();
-				if( !SetProg(line, &prog) )
-					Err("can not to recognize a "+progTip, inFileName).Throw();
-				if( _initStream	)	// if write to file
-					if(prog == oPR)
-						CorrectDef(line, outFileName, space);	// write definition line now
-					else
-						defLine = line;		// postpone writing definition line to read a space
-				firstLine = false;
+	if( (line = ReadDef(file, inFileName, &prog, sLine)) == NULL )	return;
+	if( toFile && !_out.IsBinary() )
+		if(prog == oPR)
+			CorrectDef(line, outFileName, space);	// write definition line now
+		else
+			defLine = line;		// postpone writing definition line to read a span
+
+	ChromReg reg(_out, prog == oMACS, space, fragSize);	// regulator in single thread mode
+#ifdef _MULTITHREAD
+	ChromJobs jobs(_out, _stats, threadCnt);
+	ChromJob* job = NULL;		// current chromosome's job in multithread mode
+#endif
+
+	for(;;) {
+		if( declared ) {
+			// data lines are decoded by batches, which are stopped by declaration line;
+			// batch is tokenized while parsing and is long enough to be measured exactly
+			Stages::Switch(Stages::PARSE, true);
+			cnt = file.GetData(pos, vals, DATA_BATCH, line);
+			Stages::Switch(Stages::REGULATE, true);
+			// abs() in case of PeakRanger negative strand
+#ifdef _MULTITHREAD
+			if( job )
+				for(i=0; i<cnt; i++)	job->AddData(pos[i], abs(vals[i]));
+			else
+#endif
+				for(i=0; i<cnt; i++)	reg.AddData(pos[i], abs(vals[i]));
+			if( !line ) {
+				if( cnt < DATA_BATCH )	break;	// end of file
+				continue;						// full batch
 			}
-		else if( isdigit(line[0]) ) {	// data line
-			pos = newPos;
-			val = newVal;
-			newPos = file.IntField(0);
-			newVal = abs(file.IntField(1));		// abs() in case of PeakRanger negative strand
-			if( pos )		// second data line for current chromosome
-				if( prog == oMACS ) {
-					if( newPos-pos == span	&& val == newVal ) {
-						spanCnt++;		// accumulate span for given val
-						continue;
-					}
-					if( prevSpanCnt != spanCnt )	// change accumulative span
-						PrintDeclLine((prevSpanCnt = spanCnt) * span);
-					PrintLine(startPos, val);
-					startPos = newPos;
-					spanCnt = 1;
-				}
-				else {		// PEAKRANGER
-					if(space > 1)		newPos = AlignPos(newPos, space, 1);
-					posDiff = newPos-pos;
-					if(posDiff > span)
-						PrintDeclLine(prevSpan = min(posDiff, fragSize)); // fill "gap"
-					else {
-						if( !posDiff ) {	// possible if space > 1:
-							// just skip this line,
-							// but save a maximum value between this and next lines
-							if(val > newVal)	newVal = val;
-							continue;
-						}
-						PrintDeclLine(prevSpan = span);	// write single record
-					}
-					PrintLine(pos, val);
-				}
-			else {		// first data line for current chromosome
-				if(space > 1)		newPos = AlignPos(newPos, space, 1);
-				startPos = newPos;
+			Stages::Switch(Stages::PARSE, true);
+		}
+		else {
+			Stages::Switch(Stages::TOKENIZE);
+			if( (line = file.GetLine()) == NULL )	break;
+			Stages::Switch(Stages::PARSE);
+			if( isdigit(line[0]) )		// data line
+				file.ThrowLineExcept("wrong wig format: absent '" + string(keyStep) + "' declaration");
+		}
+		// declaration line
+		line = LineStr(file, line, sLine);
+		CheckSpec(line, keyStep, file);
+		sName = CheckSpec(line, keyChrom, file);
+		len = strcspn(sName, sBLANK);
+		if( !declared || cName.compare(0, string::npos, sName, len) ) {	// new chromosome
+			Stages::Switch(Stages::REGULATE);
+#ifdef _MULTITHREAD
+			if( threadCnt > 1 ) {
+				if( job )	EndChromInput(cName, job->Stats(), file.ReadPosition());
+				job = jobs.Add(string(sName, len), prog == oMACS, space, fragSize);
+			}
+			else
+#endif
+			{
+				if( declared )	CloseChrom(reg, cName, file.ReadPosition());	// last data line for current chromosome
+				_out.Chrom(string(sName, len));
 			}
+			cName.assign(sName, len);
+			Progress::Chrom(cName);
+			declared = true;
+		}
+#ifdef _MULTITHREAD
+		if( job )	job->Declare(line);
+		else
+#endif
+			reg.Declare(line);
+		if( defLine.length() ) {	// delayed writing definition line; for MACS only
+			const char* sSpan = KeyStr(line, keySpan);
+			CorrectDef(defLine.c_str(), outFileName, sSpan ? atoi(sSpan) : 1);
+			defLine.clear();
 		}
-		else {							// declaration line
-			CheckSpec(line, keyStep, file);
-			chrid newcID = Chrom::IDbyAbbrName(CheckSpec(line, keyChrom, file));
-			if( cID != Chrom::UnID && newcID != cID ) {	// new chromosome
-				// last data line for current chromosome
-				if( prog == oMACS )	PrintRecord(startPos, spanCnt*span, val);
-				else				PrintRecord(newPos, fragSize, val);
-				pos = newPos = 0;
+	}
+	// last data line
+	Stages::Switch(Stages::REGULATE);
+#ifdef _MULTITHREAD
+	if( job ) {
+		EndChromInput(cName, job->Stats(), file.ReadPosition());
+		jobs.Flush();
+	}
+	else
+#endif
+		if( declared )	CloseChrom(reg, cName, file.ReadPosition());
+	Stages::Switch(Stages::NONE);
+	_lineCnt = file.RecordCount();
+	_stats.AddInput(file);
+}
+
+// Merges and regulates the wiggles of plus and minus strands from PeakRanger
+//	@plusFileName: plus strand's file name or "stdin"
+//	@minusFileName: minus strand's file name
+//	@outFileName: output file name or "stdout"
+//	@threadCnt: number of inflating threads
+void WigReg::Merge(const char* plusFileName, const char* minusFileName, const char* outFileName, BYTE threadCnt)
+{
+	BYTE	plusProg = Options::GetIVal(oPROGR),
+			minusProg = plusProg,
+			space = Options::GetIVal(oSPACE);
+	chrlen	fragSize = Options::GetIVal(oFRAG_LEN);
+	StrandReader plus(plusFileName, threadCnt, &plusProg);
+	StrandReader minus(FS::CheckedFileName(minusFileName), threadCnt, &minusProg);
+	const bool sign = Options::GetBVal(oSIGNED);
+	bool	started = false;	// true if at least one chromosome is output
+
+	if( plusProg != oPR || minusProg != oPR )
+		Err("merging is supported for " + string(sPR) + " wiggles only").Throw();
+	if(space > 1)		fragSize = AlignPos(fragSize, space, 0);
+	_out.Open(outFileName, threadCnt, Options::GetSVal(oCHROM_SIZES));
+	if( _stricmp(outFileName, "stdout") && !_out.IsBinary() )
+		CorrectDef(plus.DefLine(), outFileName, space);
+
+	ChromReg reg(_out, false, space, fragSize);
+	string	cName;		// current chromosome's name
+	// chromosomes of plus strand in input order, joined with the same ones of minus strand
+	while( plus.NextChrom() ) {
+		if( started )	CloseChrom(reg, cName);
+		_out.Chrom(cName = plus.Chrom());
+		Progress::Chrom(cName);
+		reg.Declare(plus.DeclLine());
+		MergeChrom(reg, &plus, minus.SeekChrom(plus.Chrom()) ? &minus : NULL, sign);
+		started = true;
+	}
+	// the rest of chromosomes presented in minus strand only
+	while( minus.NextChrom() ) {
+		if( started )	CloseChrom(reg, cName);
+		_out.Chrom(cName = minus.Chrom());
+		Progress::Chrom(cName);
+		reg.Declare(minus.DeclLine());
+		MergeChrom(reg, NULL, &minus, sign);
+		started = true;
+	}
+	if( started )	CloseChrom(reg, cName);
+	_stats.AddInput(plus.File());
+	_stats.AddInput(minus.File());
+}
+
+// Outputs merged records of current chromosome
+//	@reg: regulator
+//	@plus: plus strand positioned on chromosome, or NULL if chromosome is absent in it
+//	@minus: minus strand positioned on chromosome, or NULL if chromosome is absent in it
+//	@sign: true if minus strand's values are subtracted, otherwise added
+void WigReg::MergeChrom(ChromReg& reg, StrandReader* plus, StrandReader* minus, bool sign)
+{
+	chrlen	pos;
+	wigval	val;
+	bool	isPlus, isMinus;	// true if strand has record
+
+	for(;;) {
+		isPlus = plus && plus->IsData();
+		isMinus = minus && minus->IsData();
+		if( isPlus && (!isMinus || plus->Pos <= minus->Pos) ) {
+			pos = plus->Pos;
+			val = plus->Val;
+			if( isMinus && minus->Pos == pos ) {	// the same position in both strands
+				val += sign ? -minus->Val : minus->Val;
+				minus->NextData();
 			}
-			cID = newcID;
-			startPos = pos;
-			sSpan = KeyStr(line, keySpan);
-			if( sSpan ) {
-				prevSpan = span = atoi(sSpan);
-				_declLine = string(line, sSpan-line);
+			plus->NextData();
+		}
+		else if( isMinus ) {
+			pos = minus->Pos;
+			val = sign ? -minus->Val : minus->Val;
+			minus->NextData();
+		}
+		else	break;
+		Stages::Switch(Stages::REGULATE);
+		reg.AddData(pos, val);
+		_lineCnt++;
+	}
+}
+
+/************************ end of class Wig ************************/
+
+/************************ class WigStats ************************/
+
+bool WigStats::Enabled = false;
+
+// Adds counters
+//	@stats: added counters
+void ChromStats::Add(const ChromStats& stats)
+{
+	InRecords += stats.InRecords;
+	OutRecords += stats.OutRecords;
+	Merged += stats.Merged;
+	Dropped += stats.Dropped;
+	GapFills += stats.GapFills;
+	InBytes += stats.InBytes;
+	Time += stats.Time;
+}
+
+// Prints string as JSON string
+//	@s: output stream
+//	@str: printed string
+void JsonStr(ostream& s, const string& str)
+{
+	s << DQUOT;
+	for(string::const_iterator c=str.begin(); c!=str.end(); c++)
+		if( *c == DQUOT || *c == '\\' )	s << '\\' << *c;
+		else if( BYTE(*c) < BLANK )
+			s << "\\u00" << hex << setfill('0') << setw(2) << int(*c) << dec << setfill(BLANK);
+		else	s << *c;
+	s << DQUOT;
+}
+
+// Adds the counters of read file
+//	@file: read file
+void WigStats::AddInput(const TxtFile& file)
+{
+	InBytes += file.ReadLength();
+	InZipBytes += file.ReadOffset();
+	InLines += file.RecordCount();
+}
+
+// Adds the counters of chromosome
+//	@name: chromosome's name
+//	@stats: chromosome's counters
+void WigStats::AddChrom(const string& name, const ChromStats& stats)
+{
+	Total.Add(stats);
+	if( _chroms.size() && _chroms.back().Name == name )		// the same chromosome is continued
+		_chroms.back().Stats.Add(stats);
+	else
+		_chroms.push_back(ChromItem(name, stats));
+}
+
+// Prints statistics as JSON object
+//	@s: output stream
+//	@indent: indent of object's members
+void WigStats::Print(ostream& s, const string& indent) const
+{
+	s << indent << "\"input\": ";		JsonStr(s, InName);
+	s << ",\n" << indent << "\"output\": ";	JsonStr(s, OutName);
+	s << ",\n" << indent << "\"format\": \"" << FormatVals[Options::GetIVal(oFORMAT)] << DQUOT;
+	s << ",\n" << indent << "\"input_bytes\": " << InBytes;
+	s << ",\n" << indent << "\"input_compressed_bytes\": " << InZipBytes;
+	s << ",\n" << indent << "\"input_lines\": " << InLines;
+	s << ",\n" << indent << "\"output_lines\": " << OutLines;
+	s << ",\n" << indent << "\"output_bytes\": " << OutBytes;
+	s << ",\n" << indent << "\"output_file_bytes\": ";
+	if( OutFileBytes < 0 )	s << "null";
+	else					s << OutFileBytes;
+	s << ",\n" << indent << "\"input_records\": " << Total.InRecords;
+	s << ",\n" << indent << "\"output_records\": " << Total.OutRecords;
+	s << ",\n" << indent << "\"merged_records\": " << Total.Merged;
+	s << ",\n" << indent << "\"dropped_lines\": " << Total.Dropped;
+	s << ",\n" << indent << "\"gap_fills\": " << Total.GapFills;
+	s << ",\n" << indent << "\"chromosomes\": [";
+	for(vector<ChromItem>::const_iterator it=_chroms.begin(); it!=_chroms.end(); it++) {
+		s << (it == _chroms.begin() ? "\n" : ",\n") << indent << "\t{ \"name\": ";
+		JsonStr(s, it->Name);
+		s << ", \"input_records\": " << it->Stats.InRecords
+		  << ", \"output_records\": " << it->Stats.OutRecords
+		  << ", \"merged_records\": " << it->Stats.Merged
+		  << ", \"dropped_lines\": " << it->Stats.Dropped
+		  << ", \"gap_fills\": " << it->Stats.GapFills << " }";
+	}
+	s << (_chroms.size() ? "\n" + indent : strEmpty) << ']';
+}
+
+// Saves statistics as JSON file
+//	@fName: file name
+void WigStats::Save(const char* fName) const
+{
+	ofstream file(fName);
+	if( !file )		Err(Err::F_OPEN, fName).Throw();
+	file << "{\n";
+	Print(file, "\t");
+	file << "\n}\n";
+	file.close();
+	if( !file )		Err(Err::F_WRITE, fName).Throw();
+}
+
+// Prints the table of chromosomes' treatment time and throughput
+//	@s: output stream
+void WigStats::PrintTimes(ostream& s) const
+{
+	const float mb = 1024 * 1024;
+	size_t nameLen = 5;		// width of the names column, at least the title's width
+
+	for(vector<ChromItem>::const_iterator it=_chroms.begin(); it!=_chroms.end(); it++)
+		if( it->Name.length() > nameLen )	nameLen = it->Name.length();
+	s << left << setw(nameLen) << "chrom" << right
+	  << setw(12) << "records" << setw(10) << "in,MB" << setw(10) << "time,s"
+	  << setw(9) << "MB/s" << setw(12) << "records/s" << EOL;
+	s << fixed;
+	for(vector<ChromItem>::const_iterator it=_chroms.begin(); it!=_chroms.end(); it++) {
+		const double time = it->Stats.Time / 1e9;
+		s << left << setw(nameLen) << it->Name << right
+		  << setw(12) << it->Stats.InRecords
+		  << setw(10) << setprecision(1) << it->Stats.InBytes / mb
+		  << setw(10) << setprecision(3) << time
+		  << setw(9) << setprecision(1);
+		if( it->Stats.InBytes && time > 0 )	s << it->Stats.InBytes / mb / time;
+		else								s << '-';
+		s << setw(12) << setprecision(0) << (time > 0 ? it->Stats.InRecords / time : 0) << EOL;
+	}
+	s.unsetf(ios_base::floatfield);
+	s << setprecision(6);
+}
+
+/************************ end of class WigStats ************************/
+
+/************************ class StrandReader ************************/
+
+// Opens wiggle and reads its definition
+//	@fName: file name or "stdin"
+//	@threadCnt: number of inflating threads
+//	@prog: point to variable to set a program-source value
+StrandReader::StrandReader(const char* fName, BYTE threadCnt, BYTE* prog) :
+	_file(fName, TxtFile::READ, 2, 2, '\0', NULL, true, true, false, true, threadCnt),
+	_recInd(0), _replaying(false), _isData(false), Pos(0), Val(0)
+{
+	_file.TrackProgress();
+	const char* line = ReadDef(_file, fName, prog, _sLine);
+
+	if( !line )		return;			// no definition: empty wiggle
+	_defLine = line;
+	if( (line = _file.GetLine()) != NULL ) {	// the first declaration
+		if( isdigit(line[0]) )
+			_file.ThrowLineExcept("wrong wig format: absent '" + string(keyStep) + "' declaration");
+		Declare(line);
+	}
+}
+
+// Applies declaration line
+//	@line: declaration line
+//	return: true if it declares the next chromosome
+bool StrandReader::Declare(const char* line)
+{
+	line = LineStr(_file, line, _sLine);
+	CheckSpec(line, keyStep, _file);
+	const char* sName = CheckSpec(line, keyChrom, _file);
+	const size_t len = strcspn(sName, sBLANK);
+
+	if( !_chrom.compare(0, string::npos, sName, len) )	return false;	// the same chromosome
+	_nextChrom.assign(sName, len);
+	_nextDecl = _sLine;
+	return true;
+}
+
+// Moves to the next data line of current chromosome
+//	return: false if current chromosome is finished
+bool StrandReader::NextData()
+{
+	if( _replaying ) {
+		if( ++_recInd >= _replay->Pos.size() )	return _isData = false;
+		Pos = _replay->Pos[_recInd];
+		Val = _replay->Vals[_recInd];
+		return true;
+	}
+	const char* line;
+	for(Stages::Switch(Stages::TOKENIZE); (line = _file.GetLine()) != NULL; Stages::Switch(Stages::TOKENIZE))
+		if( isdigit(line[0]) ) {		// data line
+			Stages::Switch(Stages::PARSE);
+			_file.UIntField(0, Pos);
+			_file.IntField(1, Val);
+			Val = abs(Val);				// negative strand
+			return _isData = true;
+		}
+		else if( Declare(line) )	break;
+	return _isData = false;
+}
+
+// Moves to the next chromosome in file
+//	return: false if file is finished
+bool StrandReader::StreamChrom()
+{
+	if( _nextChrom.empty() )	return false;
+	_chrom.swap(_nextChrom);
+	_declLine.swap(_nextDecl);
+	_nextChrom.clear();
+	NextData();
+	return true;
+}
+
+// Reads the next chromosome in file into memory
+void StrandReader::KeepChrom()
+{
+	StreamChrom();
+	_kept.push_back(KeptChrom());
+	KeptChrom& chrom = _kept.back();
+	chrom.Name = _chrom;
+	chrom.DeclLine = _declLine;
+	for(; _isData; NextData()) {
+		chrom.Pos.push_back(Pos);
+		chrom.Vals.push_back(Val);
+	}
+}
+
+// Moves to kept chromosome
+//	@it: kept chromosome
+void StrandReader::StartReplay(list<KeptChrom>::iterator it)
+{
+	_replay = it;
+	_replaying = true;
+	_chrom = it->Name;
+	_declLine = it->DeclLine;
+	_recInd = 0;
+	if( (_isData = it->Pos.size() > 0) ) {
+		Pos = it->Pos[0];
+		Val = it->Vals[0];
+	}
+}
+
+// Releases kept chromosome if it is current
+void StrandReader::EndReplay()
+{
+	if( _replaying ) {
+		_kept.erase(_replay);
+		_replaying = false;
+	}
+}
+
+// Moves to the next chromosome: kept ones first, then the next one in file
+//	return: false if there are no more chromosomes
+bool StrandReader::NextChrom()
+{
+	EndReplay();
+	if( _kept.size() ) {
+		StartReplay(_kept.begin());
+		return true;
+	}
+	return StreamChrom();
+}
+
+// Moves to the chromosome by name, keeping skipped ones in memory
+//	@name: chromosome's name
+//	return: false if there is no such chromosome
+bool StrandReader::SeekChrom(const string& name)
+{
+	EndReplay();
+	for(list<KeptChrom>::iterator it=_kept.begin(); it!=_kept.end(); it++)
+		if( it->Name == name ) {
+			StartReplay(it);
+			return true;
+		}
+	for(; !_nextChrom.empty(); KeepChrom())
+		if( _nextChrom == name )	return StreamChrom();
+	return false;
+}
+
+/************************ end of class StrandReader ************************/
+
+/************************ class WigWriter ************************/
+
+#define WRITER_MEM_SIZE		(BASE_BLK_SIZE >> 4)	// initial size of output kept in memory
+
+size_t WigWriter::BuffLen = BASE_BLK_SIZE;
+
+const char WigWriter::Digits[] =
+	"00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+	"40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
+
+// Creates new instance keeping output in memory
+//	@format: output format
+WigWriter::WigWriter(eFormat format) :
+	_format(format), _buff(NULL), _buffLen(0), _len(0), _outLen(0), _lineCnt(0), _span(1),
+	_fd(-1), _closeFd(false), _error(false), _bigWig(NULL), _track(NULL)
+#if defined _MULTITHREAD && !defined _NO_ZLIB
+	, _zipper(NULL)
+#endif
+{}
+
+WigWriter::~WigWriter()
+{
+	Close();
+	if( _buff ) {
+		delete [] _buff;
+		Memory::Add(Memory::OUTPUT, -LLONG(_buffLen));
+	}
+}
+
+// Sets output file.
+//	@fName: file name or "stdout"; wiggle file with ".gz" extension is written as BGZF
+//	@threadCnt: number of deflating threads
+//	@chromSizes: name of chrom.sizes file; for bigWig only
+void WigWriter::Open(const char* fName, BYTE threadCnt, const char* chromSizes)
+{
+	if( IsBinary() && !_stricmp(fName, "stdout") )
+		Err("binary output cannot be written to stdout").Throw();
+	if( _format == fBW ) {
+		if( !chromSizes )
+			Err(Err::MISSED, NULL, "chrom.sizes file for bigWig output").Throw();
+		_bigWig = new BigWigFile(fName, chromSizes);
+	}
+	else if( _format == fBIN )
+		_track = new TrackWriter(fName);
+	else if( !_stricmp(fName, "stdout") )
+		_fd = fileno(stdout);
+#if defined _MULTITHREAD && !defined _NO_ZLIB
+	else if( FS::HasGzipExt(fName) ) {
+		FILE* file = fopen(fName, "wb");
+		if( !file )		Err(Err::F_OPEN, fName).Throw();
+		_zipper = new Zipper(file, threadCnt);
+	}
+#endif
+	else {
+		_fd = open(fName, O_WRONLY | O_CREAT | O_TRUNC
+#ifdef OS_Windows
+			| O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+			, 0666);
+#endif
+		if( _fd < 0 )	Err(Err::F_OPEN, fName).Throw();
+		_closeFd = true;
+	}
+	if( !_buff ) {
+		_buff = new char[_buffLen = BuffLen];
+		Memory::Add(Memory::OUTPUT, _buffLen);
+	}
+}
+
+// Provides room for chars: writes accumulated output or increases buffer kept in memory
+//	@len: number of chars
+void WigWriter::Reserve(size_t len)
+{
+	if( _len + len <= _buffLen )	return;
+	if( ToFile() ) {
+		Flush();
+		if( len <= _buffLen )	return;
+	}
+	// increase buffer
+	size_t buffLen = _buffLen ? _buffLen : WRITER_MEM_SIZE;
+	while( buffLen < _len + len )	buffLen <<= 1;
+	char* buff = new char[buffLen];
+	Memory::Add(Memory::OUTPUT, buffLen);
+	if( _buff ) {
+		memcpy(buff, _buff, _len);
+		delete [] _buff;
+		Memory::Add(Memory::OUTPUT, -LLONG(_buffLen));
+	}
+	_buff = buff;
+	_buffLen = buffLen;
+}
+
+// Writes accumulated output
+void WigWriter::Flush()
+{
+	if( !_len || !ToFile() )	return;		// nothing to write or output is kept in memory
+	const Stages::eStage stage = Stages::Switch(Stages::OUTPUT);
+	Trace::Span span("block", "write");
+	if( _bigWig )
+		_bigWig->Add((const TrackRecord*)_buff, _len / sizeof(TrackRecord));
+	else if( _track )
+		_track->Add((const TrackRecord*)_buff, _len / sizeof(TrackRecord));
+	else
+#if defined _MULTITHREAD && !defined _NO_ZLIB
+	if( _zipper ) {
+		if( !_zipper->Write(_buff, _len) )	_error = true;
+	}
+	else
+#endif
+		for(const char* buff = _buff; !_error && buff < _buff + _len; ) {
+			int res = write(_fd, buff, UINT(_buff + _len - buff));
+			if( res < 0 )	_error = true;
+			else			buff += res;
+		}
+	if( WigStats::Enabled )
+		_lineCnt += IsBinary() ? _len / sizeof(TrackRecord) : count(_buff, _buff + _len, EOL);
+	_outLen += _len;
+	_len = 0;
+	Stages::Switch(stage);
+}
+
+// Writes accumulated output and closes file.
+//	return: true if successful
+bool WigWriter::Close()
+{
+	Flush();
+	if( _bigWig ) {
+		if( !_bigWig->Close() )	_error = true;
+		delete _bigWig;
+		_bigWig = NULL;
+	}
+	if( _track ) {
+		if( !_track->Close() )	_error = true;
+		delete _track;
+		_track = NULL;
+	}
+#if defined _MULTITHREAD && !defined _NO_ZLIB
+	if( _zipper ) {
+		if( !_zipper->Close() )	_error = true;
+		delete _zipper;
+		_zipper = NULL;
+	}
+#endif
+	if( _closeFd ) {
+		if( close(_fd) )	_error = true;
+		_closeFd = false;
+	}
+	_fd = -1;
+	return !_error;
+}
+
+// Adds unsigned integer
+void WigWriter::Int(UINT val)
+{
+	Reserve(INT_CAPACITY);
+	// count digits
+	BYTE cnt = 1;
+	for(UINT v = val; v >= 10; v /= 10)	cnt++;
+	char* dst = _buff + _len + cnt;
+	_len += cnt;
+	// convert by pairs of digits from the end
+	for(; val >= 100; val /= 100) {
+		const char* d = Digits + ((val % 100) << 1);
+		*--dst = d[1];
+		*--dst = d[0];
+	}
+	if( val >= 10 ) {
+		const char* d = Digits + (val << 1);
+		*--dst = d[1];
+		*--dst = d[0];
+	}
+	else
+		*--dst = char('0' + val);
+}
+
+// Adds record as interval: binary for bigWig and binary track, text line for bedGraph
+//	@pos: record's position
+//	@val: record's value
+void WigWriter::Interval(chrlen pos, wigval val)
+{
+	if( IsBinary() ) {
+		Reserve(sizeof(TrackRecord));
+		TrackRecord* rec = (TrackRecord*)(_buff + _len);
+		rec->Pos = pos;
+		rec->Span = _span;
+		rec->Val = val;
+		_len += sizeof(TrackRecord);
+	}
+	else {	// bedGraph: 0-based half-open interval
+		if( pos )	pos--;
+		Str(_chrom);	Char(TAB);
+		Int(pos);		Char(TAB);
+		Int(pos + _span);	Char(TAB);
+		SInt(val);		Char(EOL);
+	}
+}
+
+// Starts new chromosome
+//	@name: chromosome's name
+void WigWriter::Chrom(const string& name)
+{
+	if( _bigWig )		{ Flush();	_bigWig->SetChrom(name); }
+	else if( _track )	{ Flush();	_track->SetChrom(name); }
+	else if( _format == fBG )
+		_chrom = name;
+}
+
+// Adds fixedStep declaration line
+//	@line: fixedStep declaration line without value of start
+//	@start: value of start
+//	@span: value of step and span
+void WigWriter::FixedDecl(const string& line, chrlen start, chrlen span)
+{
+	Str(line);		Int(start);
+	Char(BLANK);	Str(keyStepLen);	Int(span);
+	Char(BLANK);	Str(keySpan);	Int(span);
+	Char(EOL);
+}
+
+/************************ end of class WigWriter ************************/
+
+/************************ class ChromReg ************************/
+
+// Creates new instance
+//	@out: output
+//	@isMACS: true if wiggle is generated by MACS
+//	@space: resolution
+//	@fragSize: length of fragment aligned to resolution
+ChromReg::ChromReg(WigWriter& out, bool isMACS, BYTE space, chrlen fragSize) :
+	_out(out), _isMACS(isMACS), _fixStep(out.Format() == fWIG), _space(space), _fragSize(fragSize)
+{
+	Reset();
+}
+
+// Sets the initial state
+void ChromReg::Reset()
+{
+	_pos = _newPos = _startPos = _declSpan = 0;
+	_runPos = _runSpan = _runCnt = 0;
+	_spanCnt = _span = 1;
+	_val = _newVal = 0;
+	_empty = true;
+	_fixed = false;
+	_runVals.clear();
+}
+
+// Outputs regulated record.
+// Accumulates runs of abutting records with the same span to output them as fixedStep block.
+//	@pos: record's position
+//	@span: record's span
+//	@val: record's value
+void ChromReg::PrintRecord(chrlen pos, chrlen span, wigval val)
+{
+	_stats.OutRecords++;
+	if( !_fixStep ) {		// interval formats don't need declarations
+		if( _declSpan != span )		_out.Decl(_declLine, _declSpan = span);
+		_out.Line(pos, val);
+		return;
+	}
+	if( _runCnt && span == _runSpan && pos == _runPos + _runCnt * span ) {	// continue run
+		_runCnt++;
+		if( _fixed )	_out.Value(val);
+		else {
+			_runVals.push_back(val);
+			if( _runVals.size() == FIXED_MIN_CNT ) {	// run is long enough: switch to fixedStep
+				_out.FixedDecl(_fixDeclLine, _runPos, span);
+				for(vector<wigval>::const_iterator it=_runVals.begin(); it!=_runVals.end(); it++)
+					_out.Value(*it);
+				_runVals.clear();
+				_fixed = true;
+				_declSpan = 0;	// next variableStep record has to be declared again
+			}
+		}
+		return;
+	}
+	FlushRun();
+	_runPos = pos;
+	_runSpan = span;
+	_runCnt = 1;
+	_runVals.push_back(val);
+}
+
+// Outputs accumulated records of current run as variableStep lines and starts new run
+void ChromReg::FlushRun()
+{
+	if( !_runVals.empty() ) {
+		if( _declSpan != _runSpan )		_out.Decl(_declLine, _declSpan = _runSpan);
+		chrlen pos = _runPos;
+		for(vector<wigval>::const_iterator it=_runVals.begin(); it!=_runVals.end(); it++, pos += _runSpan)
+			_out.Line(pos, *it);
+		_runVals.clear();
+	}
+	_runCnt = 0;
+	_fixed = false;
+}
+
+// Applies declaration line
+//	@line: checked declaration line
+void ChromReg::Declare(const char* line)
+{
+	const char* sSpan = KeyStr(line, keySpan);	// pointer to the substring - span value
+
+	_startPos = _pos;
+	if( sSpan ) {
+		_span = atoi(sSpan);
+		_declLine = string(line, sSpan-line);
+	}
+	else {	// absent keySpan: set by default
+		_span = 1;
+		_declLine = string(line) + sBLANK + keySpan;
+	}
+	if( _fixStep ) {
+		const char* sChrom = KeyStr(line, keyChrom);
+		if( sChrom ) {
+			const char* end = strchr(sChrom, BLANK);
+			_fixDeclLine = string(keyFixStep) + BLANK + keyChrom
+				+ (end ? string(sChrom, end-sChrom) : string(sChrom)) + BLANK + keyStart;
+		}
+	}
+}
+
+// Regulates data line
+//	@pos: line's position
+//	@val: line's value
+void ChromReg::AddData(chrlen pos, wigval val)
+{
+	_pos = _newPos;
+	_val = _newVal;
+	_newPos = pos;
+	_newVal = val;
+	_empty = false;
+	_stats.InRecords++;
+	if( _pos )		// second data line for current chromosome
+		if( _isMACS ) {
+			if( _newPos-_pos == _span && _val == _newVal ) {
+				_spanCnt++;		// accumulate span for given val
+				_stats.Merged++;
+				return;
 			}
-			else {	// absent keySpan: set by default
-				prevSpan = span = 1;
-				_declLine = string(line) + sBLANK + keySpan;
+			PrintRecord(_startPos, _spanCnt * _span, _val);
+			_startPos = _newPos;
+			_spanCnt = 1;
+		}
+		else {		// PEAKRANGER
+			if(_space > 1)		_newPos = AlignPos(_newPos, _space, 1);
+			chrlen posDiff = _newPos-_pos;
+			if(posDiff > _span) {
+				PrintRecord(_pos, min(posDiff, _fragSize), _val);	// fill "gap"
+				_stats.GapFills++;
 			}
-			if( defLine ) {	// delayed writing definition line; for MACS only
-				CorrectDef(defLine, outFileName, span);
-				defLine = NULL;
+			else {
+				if( !posDiff ) {	// possible if space > 1:
+					// just skip this line,
+					// but save a maximum value between this and next lines
+					if(_val > _newVal)	_newVal = _val;
+					_stats.Dropped++;
+					return;
+				}
+				PrintRecord(_pos, _span, _val);	// write single record
 			}
 		}
+	else {		// first data line for current chromosome
+		if(_space > 1)		_newPos = AlignPos(_newPos, _space, 1);
+		_startPos = _newPos;
 	}
-	// last data line
-	if( !_empty) 
-		if( prog == oMACS )	PrintRecord(startPos, spanCnt*span, val);
-		else				PrintRecord(newPos, fragSize, val);
 }
 
-/************************ end of class Wig ************************/
+// Outputs the last record of chromosome and sets the initial state
+void ChromReg::Close()
+{
+	if( !_empty )
+		if( _isMACS )	PrintRecord(_startPos, _spanCnt*_span, _val);
+		else			PrintRecord(_newPos, _fragSize, _val);
+	FlushRun();
+	Reset();
+}
+
+/************************ end of class ChromReg ************************/
+
+#ifdef _MULTITHREAD
+
+/************************ class ChromJob ************************/
+
+// Regulates stored records; thread procedure
+retThreadValType
+#ifdef OS_Windows
+	__stdcall
+#endif
+	ChromJob::Regulate(void* arg)
+{
+	ChromJob* job = (ChromJob*)arg;
+	vector<Decl>::const_iterator decl = job->_decls.begin();
+	const ULLONG start = Timer::Now();
+	Stages stages;
+
+	Trace::Attach("regulate", job);
+	Trace::Span span("chrom", job->_chrom.c_str());
+	Stages::Switch(Stages::REGULATE);
+	job->_out.Chrom(job->_chrom);
+
+	for(size_t i=0; i<job->_pos.size(); i++) {
+		for(; decl != job->_decls.end() && decl->Ind == i; decl++)
+			job->_reg.Declare(decl->Line.c_str());
+		job->_reg.AddData(job->_pos[i], job->_vals[i]);
+	}
+	for(; decl != job->_decls.end(); decl++)
+		job->_reg.Declare(decl->Line.c_str());
+	job->_reg.Close();
+	// release input records
+	vector<chrlen>().swap(job->_pos);
+	vector<wigval>().swap(job->_vals);
+	job->_reg.Stats().Time += Timer::Now() - start;
+	return retThreadValTrue;
+}
+
+// Waits for the regulation to complete
+void ChromJob::WaitFor()
+{
+	if( _thread ) {
+		_thread->WaitFor();
+		delete _thread;
+		_thread = NULL;
+	}
+}
+
+// Waits for the regulation to complete and outputs regulated records
+//	@out: output
+//	@stats: statistics to add the chromosome's counters
+void ChromJob::Print(WigWriter& out, WigStats& stats)
+{
+	const Stages::eStage stage = Stages::Switch(Stages::OUTPUT);
+	Trace::Span span("chrom", "print");
+
+	WaitFor();
+	out.Chrom(_chrom);
+	out.Str(_out.Data(), _out.Length());
+	stats.AddChrom(_chrom, _reg.Stats());
+	Stages::Switch(stage);
+}
+
+/************************ end of class ChromJob ************************/
+
+/************************ class ChromJobs ************************/
+
+ChromJobs::~ChromJobs()
+{
+	for(vector<ChromJob*>::iterator it=_jobs.begin(); it!=_jobs.end(); it++)
+		delete *it;		// waits for the started jobs
+}
+
+// Starts the filled job and adds new one.
+// Outputs the oldest jobs if the limit of simultaneously regulated jobs is reached.
+//	@chrom: chromosome's name
+//	@isMACS: true if wiggle is generated by MACS
+//	@space: resolution
+//	@fragSize: length of fragment aligned to resolution
+//	return: new job to fill
+ChromJob* ChromJobs::Add(const string& chrom, bool isMACS, BYTE space, chrlen fragSize)
+{
+	if( _jobs.size() ) {
+		_jobs.back()->Start();
+		for(; _jobs.size() >= _maxCnt; _jobs.erase(_jobs.begin())) {
+			_jobs.front()->Print(_out, _stats);
+			delete _jobs.front();
+		}
+	}
+	_jobs.push_back(new ChromJob(chrom, _out.Format(), isMACS, space, fragSize));
+	Trace::Counter("chrom jobs", _jobs.size());
+	return _jobs.back();
+}
+
+// Starts the filled job and outputs all jobs in input order
+void ChromJobs::Flush()
+{
+	_jobs.back()->Start();
+	for(; _jobs.size(); _jobs.erase(_jobs.begin())) {
+		_jobs.front()->Print(_out, _stats);
+		delete _jobs.front();
+	}
+	Trace::Counter("chrom jobs", 0);
+}
+
+/************************ end of class ChromJobs ************************/
+
+#endif	// _MULTITHREAD
+
+/************************ class WigBatch ************************/
+
+// Adds job
+//	@inName: input file name
+//	@outName: output file name; if empty, input short name in output directory is used
+//	@outDir: output directory ended by slash
+void WigBatch::AddJob(const string& inName, const string& outName, const string& outDir)
+{
+	string name = outName;
+
+	if( name.empty() ) {
+		const eFormat format = eFormat(Options::GetIVal(oFORMAT));
+		const bool zipped = FS::HasGzipExt(name = FS::ShortFileName(inName));
+
+		// replace input extensions by the format's one; compressed wiggle remains compressed
+		if( zipped )	name.erase(name.length() - ZipFileExt.length());
+		if( FS::HasExt(name, FormatExts[fWIG]) || FS::HasExt(name, FormatExts[fBIN]) )
+			name.erase(name.find_last_of(DOT));
+		name = outDir + name + FormatExts[format];
+		if( zipped && format == fWIG )	name += ZipFileExt;
+	}
+	else if( !FS::IsAbsPath(name) )
+		name = outDir + name;
+	_jobs.push_back(Job(inName, name));
+	// the same output would be written by two workers at once; the later job is failed
+	for(vector<Job>::const_iterator it=_jobs.begin(); it!=_jobs.end()-1; it++)
+		if( it->OutName == name ) {
+			_jobs.back().Error = Err("output coincides with output of " + it->InName, name).what();
+			break;
+		}
+}
+
+// Treats jobs until they run out
+//	@buffers: read buffers of worker
+void WigBatch::Work(TxtBuffers& buffers)
+{
+	for(;;) {
+#ifdef _MULTITHREAD
+		Mutex::Lock(Mutex::JOBS);
+#endif
+		Job* job = _next < _jobs.size() ? &_jobs[_next++] : NULL;
+#ifdef _MULTITHREAD
+		Mutex::Unlock(Mutex::JOBS);
+#endif
+		if( !job )	return;
+		if( job->Error.length() )	continue;	// job is failed on adding
+
+		const ULLONG start = Timer::Now();
+		const string name = FS::ShortFileName(job->InName);
+		Trace::Span span("file", name.c_str());
+		try {
+			if( job->InName == job->OutName )
+				Err("output coincides with input", job->InName.c_str()).Throw();
+			WigReg wig(job->InName.c_str(), job->OutName.c_str(), 1, &buffers);
+			job->LineCnt = wig.LineCount();
+			if( WigStats::Enabled )		job->Stats = wig.Stats();
+		}
+		catch(Err &e)				{ job->Error = e.what(); }
+		catch(const exception &e)	{ job->Error = e.what(); }
+		catch(...)					{ job->Error = "Unregistered error"; }
+		job->Time = (Timer::Now() - start) / 1e9;
+		if( (job->InSize = FS::Size(job->InName.c_str())) < 0 )	job->InSize = 0;
+		job->OutSize = job->Error.length() ? 0 : FS::Size(job->OutName.c_str());
+	}
+}
+
+#ifdef _MULTITHREAD
+// Treats jobs by separate worker; thread procedure
+//	@batch: this instance
+retThreadValType
+#ifdef OS_Windows
+	__stdcall
+#endif
+	WigBatch::Worker(void* batch)
+{
+	TxtBuffers buffers;
+	Stages stages;
+
+	Trace::Attach("worker", &buffers);
+
+	((WigBatch*)batch)->Work(buffers);
+	return retThreadValTrue;
+}
+#endif
+
+// Prints summary table
+void WigBatch::PrintSummary() const
+{
+	const float mb = 1024 * 1024;
+	size_t nameLen = 5;		// width of the names column, at least the title's width
+
+	for(vector<Job>::const_iterator it=_jobs.begin(); it!=_jobs.end(); it++)
+		if( it->InName.length() > nameLen )		nameLen = it->InName.length();
+	cout << left << setw(nameLen) << "input" << right
+		 << setw(12) << "lines" << setw(10) << "in,MB" << setw(10) << "out,MB"
+		 << setw(9) << "time,s" << setw(9) << "MB/s" << "  status\n";
+	cout << fixed;
+	for(vector<Job>::const_iterator it=_jobs.begin(); it!=_jobs.end(); it++) {
+		cout << left << setw(nameLen) << it->InName << right
+			 << setw(12) << it->LineCnt
+			 << setw(10) << setprecision(1) << it->InSize / mb
+			 << setw(10) << it->OutSize / mb
+			 << setw(9) << setprecision(2) << it->Time
+			 << setw(9) << setprecision(1)
+			 << (it->Error.empty() && it->Time > 0 ? it->InSize / mb / it->Time : 0)
+			 << "  " << (it->Error.length() ? it->Error : "OK") << EOL;
+	}
+	cout.unsetf(ios_base::floatfield);
+}
+
+// Treats files in parallel and prints summary table
+//	@input: directory of wiggles, or list of input and optional output names separated by TAB
+//	@outDir: output directory
+//	@threadCnt: number of workers
+WigBatch::WigBatch(const char* input, const char* outDir, BYTE threadCnt) : _next(0)
+{
+	if( Options::GetSVal(oMERGE) )	Err("merging is not supported in batch mode").Throw();
+	if( !FS::IsDirExist(outDir) )	Err(Err::FD_NONE, outDir).Throw();
+	const string outPath = FS::MakePath(outDir);
+
+	if( FS::IsDirExist(input) ) {
+		const string inPath = FS::MakePath(input);
+		vector<string> files;
+
+		FS::GetFiles(files, input, FormatExts[fWIG]);
+		FS::GetFiles(files, input, FormatExts[fWIG] + ZipFileExt);
+		FS::GetFiles(files, input, FormatExts[fBIN]);
+		sort(files.begin(), files.end());
+		for(vector<string>::const_iterator it=files.begin(); it!=files.end(); it++)
+			AddJob(inPath + *it, strEmpty, outPath);
+	}
+	else {
+		TabFile file(FS::CheckedFileName(input), TxtFile::READ, 1, 2, HASH, NULL, true, true, false);
+		while( file.GetLine() ) {
+			const char* outName = file.StrField(1);
+			AddJob(file.StrField(0), outName ? outName : strEmpty, outPath);
+		}
+	}
+	if( !_jobs.size() )	Err(Err::TF_EMPTY, input, "files").Throw();
+
+#ifdef _MULTITHREAD
+	if( threadCnt > _jobs.size() )	threadCnt = BYTE(_jobs.size());
+	vector<Thread*> workers(threadCnt - 1);
+	for(BYTE i=0; i<workers.size(); i++)
+		workers[i] = new Thread(Worker, this);
+#endif
+	TxtBuffers buffers;		// buffers of the main thread's worker
+	Work(buffers);
+#ifdef _MULTITHREAD
+	for(BYTE i=0; i<workers.size(); i++) {
+		workers[i]->WaitFor();
+		delete workers[i];
+	}
+#endif
+	PrintSummary();
+}
+
+// Gets the number of failed files
+size_t WigBatch::ErrorCount() const
+{
+	size_t cnt = 0;
+	for(vector<Job>::const_iterator it=_jobs.begin(); it!=_jobs.end(); it++)
+		if( it->Error.length() )	cnt++;
+	return cnt;
+}
+
+// Saves the statistics of all files as JSON file
+//	@fName: file name
+void WigBatch::SaveStats(const char* fName) const
+{
+	ofstream file(fName);
+	if( !file )		Err(Err::F_OPEN, fName).Throw();
+	file << "{\n\t\"files\": [";
+	for(vector<Job>::const_iterator it=_jobs.begin(); it!=_jobs.end(); it++) {
+		file << (it == _jobs.begin() ? "\n" : ",\n") << "\t\t{\n\t\t\t\"status\": ";
+		JsonStr(file, it->Error.length() ? it->Error : "OK");
+		file << ",\n";
+		if( it->Error.length() ) {		// input and output names only
+			WigStats stats;
+			stats.InName = it->InName;
+			stats.OutName = it->OutName;
+			stats.Print(file, "\t\t\t");
+		}
+		else
+			it->Stats.Print(file, "\t\t\t");
+		file << "\n\t\t}";
+	}
+	file << "\n\t]\n}\n";
+	file.close();
+	if( !file )		Err(Err::F_WRITE, fName).Throw();
+}
+
+/************************ end of class WigBatch ************************/
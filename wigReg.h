@@ -6,39 +6,613 @@ enum optValue {
 	oPROGR,
 	oFRAG_LEN,
 	oSPACE,
+	oMERGE,
+	oSIGNED,
+	oFORMAT,
+	oCHROM_SIZES,
+	oBATCH,
+	oTHREADS,
+	oSTATS,
+	oTRACE,
+	oMEM,
+	oMEMLIMIT,
+	oPERF,
+	oPROGRESS,
 	oTIME,
 	oHELP
 };
 
-typedef USHORT wigval;
+enum eFormat { fWIG, fBW, fBG, fBIN };	// output formats: wiggle, bigWig, bedGraph, binary track
 
-class WigReg
+typedef int wigval;	// signed to keep the values of merged minus strand
+
+// 'ChromStats' keeps the counters of chromosome's regulation
+struct ChromStats {
+	ULLONG	InRecords,		// number of input records
+			OutRecords,		// number of output records
+			Merged,			// number of records merged by MACS run-length merging
+			Dropped,		// number of PeakRanger's lines dropped by space alignment
+			GapFills,		// number of gaps filled in PeakRanger's wiggle
+			InBytes,		// number of treated input chars; 0 if it is unknown
+			Time;			// treatment time in nanoseconds
+
+	inline ChromStats()	{ Clear(); }
+
+	// Sets all counters to zero
+	inline void Clear()	{ InRecords = OutRecords = Merged = Dropped = GapFills = InBytes = Time = 0; }
+
+	// Adds counters
+	//	@stats: added counters
+	void Add(const ChromStats& stats);
+};
+
+// 'WigStats' keeps the statistics of run and writes it in JSON format
+class WigStats
+{
+private:
+	// 'ChromItem' keeps the counters of named chromosome
+	struct ChromItem {
+		string		Name;
+		ChromStats	Stats;
+		inline ChromItem(const string& name, const ChromStats& stats) : Name(name), Stats(stats) {}
+	};
+
+	vector<ChromItem> _chroms;
+
+public:
+	static bool	Enabled;	// true if output lines are counted and statistics is saved
+
+	string	InName, OutName;
+	ULLONG	InBytes,		// number of read uncompressed chars
+			InZipBytes,		// number of read compressed chars; equal to InBytes for uncompressed input
+			InLines,		// number of read lines or records of binary track
+			OutLines,		// number of output lines or records of binary format
+			OutBytes;		// number of output uncompressed chars
+	LLONG	OutFileBytes;	// size of output file, or -1 if output is standard output
+	ChromStats	Total;		// counters of all chromosomes
+
+	inline WigStats() : InBytes(0), InZipBytes(0), InLines(0), OutLines(0), OutBytes(0), OutFileBytes(-1) {}
+
+	// Adds the counters of read file
+	//	@file: read file
+	void AddInput(const TxtFile& file);
+
+	// Adds the counters of chromosome
+	//	@name: chromosome's name
+	//	@stats: chromosome's counters
+	void AddChrom(const string& name, const ChromStats& stats);
+
+	// Prints statistics as JSON object
+	//	@s: output stream
+	//	@indent: indent of object's members
+	void Print(ostream& s, const string& indent) const;
+
+	// Saves statistics as JSON file
+	//	@fName: file name
+	void Save(const char* fName) const;
+
+	// Prints the table of chromosomes' treatment time and throughput
+	//	@s: output stream
+	void PrintTimes(ostream& s) const;
+};
+
+// 'WigWriter' formats output into a big buffer and writes it by blocks.
+// Writes to file descriptor, BGZF, bigWig or binary track file, or keeps the whole output in memory.
+// In bigWig and binary track formats the buffer accumulates binary records.
+// In bedGraph format the records are written as intervals instead of declaration and data lines.
+class WigWriter
 {
 private:
+	static const char Digits[];	// pairs of digits from "00" to "99"
+
+	const eFormat _format;
+	char*	_buff;
+	size_t	_buffLen;		// capacity of buffer
+	size_t	_len;			// number of accumulated chars
+	ULLONG	_outLen;		// number of written chars
+	ULLONG	_lineCnt;		// number of written lines or binary records; if WigStats is enabled
+	chrlen	_span;			// current span; for interval formats only
+	string	_chrom;			// current chromosome's name; for bedGraph only
+	int		_fd;			// output file descriptor, or -1 if output is kept in memory or zipped
+	bool	_closeFd;		// true if file descriptor should be closed
+	bool	_error;			// true if writing is failed
+	BigWigFile* _bigWig;	// bigWig writer
+	TrackWriter* _track;	// binary track writer
+#if defined _MULTITHREAD && !defined _NO_ZLIB
+	Zipper*	_zipper;		// BGZF writer
+#endif
+
+	// Returns true if output is written to file
+	inline bool ToFile() const {
+		return _fd >= 0 || _bigWig || _track
+#if defined _MULTITHREAD && !defined _NO_ZLIB
+			|| _zipper
+#endif
+		;
+	}
+
+	// Adds record as interval: binary for bigWig and binary track, text line for bedGraph
+	//	@pos: record's position
+	//	@val: record's value
+	void Interval(chrlen pos, wigval val);
+
+	// Provides room for chars: writes accumulated output or increases buffer kept in memory
+	//	@len: number of chars
+	void Reserve(size_t len);
+
+public:
+	// Length of buffer of output written to file
+	static size_t BuffLen;
+
+	// Creates new instance keeping output in memory
+	//	@format: output format
+	WigWriter(eFormat format = fWIG);
+
+	~WigWriter();
+
+	// Gets output format
+	inline eFormat Format() const		{ return _format; }
+
+	// Returns true if output format is binary
+	inline bool IsBinary() const		{ return _format == fBW || _format == fBIN; }
+
+	// Sets output file.
+	//	@fName: file name or "stdout"; wiggle file with ".gz" extension is written as BGZF
+	//	@threadCnt: number of deflating threads
+	//	@chromSizes: name of chrom.sizes file; for bigWig only
+	void Open(const char* fName, BYTE threadCnt, const char* chromSizes = NULL);
+
+	// Writes accumulated output
+	void Flush();
+
+	// Writes accumulated output and closes file.
+	//	return: true if successful
+	bool Close();
+
+	// Gets accumulated output
+	inline const char* Data() const		{ return _buff; }
+
+	// Gets the length of accumulated output
+	inline size_t Length() const		{ return _len; }
+
+	// Gets the number of written chars
+	inline ULLONG WrittenLength() const	{ return _outLen; }
+
+	// Gets the number of written lines or binary records; if WigStats is enabled
+	inline ULLONG LineCount() const		{ return _lineCnt; }
+
+	// Adds char
+	inline void Char(char c) { Reserve(1); _buff[_len++] = c; }
+
+	// Adds chars
+	//	@str: chars to add
+	//	@len: number of chars
+	inline void Str(const char* str, size_t len) {
+		Reserve(len);
+		memcpy(_buff + _len, str, len);
+		_len += len;
+	}
+
+	// Adds null-terminated string
+	inline void Str(const char* str)	{ Str(str, strlen(str)); }
+
+	// Adds string
+	inline void Str(const string& str)	{ Str(str.c_str(), str.length()); }
+
+	// Adds unsigned integer
+	void Int(UINT val);
+
+	// Adds signed integer
+	inline void SInt(int val) {
+		if( val < 0 )	{ Char('-'); Int(0U - UINT(val)); }
+		else			Int(UINT(val));
+	}
+
+	// Starts new chromosome
+	//	@name: chromosome's name
+	void Chrom(const string& name);
+
+	// Adds declaration line
+	//	@line: declaration line without value of span
+	//	@span: value of span
+	inline void Decl(const string& line, chrlen span) {
+		if( _format == fWIG )	{ Str(line); Int(span); Char(EOL); }
+		else	_span = span;
+	}
+
+	// Adds fixedStep declaration line
+	//	@line: fixedStep declaration line without value of start
+	//	@start: value of start
+	//	@span: value of step and span
+	void FixedDecl(const string& line, chrlen start, chrlen span);
+
+	// Adds data line of fixedStep block
+	//	@val: line's value
+	inline void Value(wigval val)	{ SInt(val); Char(EOL); }
+
+	// Adds data line
+	//	@pos: line's position
+	//	@val: line's value
+	inline void Line(chrlen pos, wigval val) {
+		if( _format != fWIG )	{ Interval(pos, val); return; }
+		Int(pos);
+		Char(TAB);
+		SInt(val);
+		Char(EOL);
+	}
+};
+
+// 'ChromReg' regulates the records of one chromosome.
+// Keeps the whole regulation state, so chromosomes can be regulated independently.
+class ChromReg
+{
+private:
+	WigWriter&	_out;			// output
 	string		_declLine;		// current declaration line without value of span
-	streambuf*	_initStream;	// pointer to initial ostream
-	ofstream	_outFile;
-	bool	_empty;				// true if no value is added
-	//ogzstream	_outzFile;
+	string		_fixDeclLine;	// fixedStep declaration line without value of start
+	const bool	_isMACS;		// true if wiggle is generated by MACS, false if by PeakRanger
+	const bool	_fixStep;		// true if runs of records can be output as fixedStep blocks
+	const BYTE	_space;			// resolution; for PR only
+	const chrlen _fragSize;		// length of fragment; for PR only
+	chrlen	_pos, _newPos,		// current line's, new line's positions
+			_startPos,			// current writing region's position
+			_spanCnt,			// current span counter (for the same values); for MACS only
+			_span,				// current declarative span
+			_declSpan,			// span of the last output variableStep declaration, or 0
+			_runPos,			// start position of current run of abutting records with the same span
+			_runSpan,			// span of current run
+			_runCnt;			// number of records in current run
+	vector<wigval> _runVals;	// values of current run which is not output yet
+	wigval	_val, _newVal;		// current, new readed values
+	bool	_empty;				// true if no data line is added
+	bool	_fixed;				// true if current run is output as fixedStep block
+	ChromStats	_stats;			// counters of current chromosome
+
+	// Sets the initial state
+	void Reset();
+
+	// Outputs regulated record.
+	// Accumulates runs of abutting records with the same span to output them as fixedStep block.
+	//	@pos: record's position
+	//	@span: record's span
+	//	@val: record's value
+	void PrintRecord(chrlen pos, chrlen span, wigval val);
+
+	// Outputs accumulated records of current run as variableStep lines and starts new run
+	void FlushRun();
+
+public:
+	// Creates new instance
+	//	@out: output
+	//	@isMACS: true if wiggle is generated by MACS
+	//	@space: resolution
+	//	@fragSize: length of fragment aligned to resolution
+	ChromReg(WigWriter& out, bool isMACS, BYTE space, chrlen fragSize);
+
+	// Applies declaration line
+	//	@line: checked declaration line
+	void Declare(const char* line);
+
+	// Regulates data line
+	//	@pos: line's position
+	//	@val: line's value
+	void AddData(chrlen pos, wigval val);
+
+	// Outputs already regulated record, e.g. decoded from binary track
+	//	@pos: record's position
+	//	@span: record's span
+	//	@val: record's value
+	inline void AddRecord(chrlen pos, chrlen span, wigval val)
+	{
+		_stats.InRecords++;
+		PrintRecord(pos, span, val);
+	}
+
+	// Outputs the last record of chromosome and sets the initial state
+	void Close();
+
+	// Gets the counters of chromosome; they are not cleared by Close()
+	inline ChromStats& Stats()	{ return _stats; }
+};
+
+#ifdef _MULTITHREAD
+// 'ChromJob' keeps the records of one chromosome and regulates them in a separate thread.
+class ChromJob
+{
+private:
+	// 'Decl' keeps declaration line and the index of the record before which it is placed
+	struct Decl {
+		size_t	Ind;
+		string	Line;
+		inline Decl(size_t ind, const char* line) : Ind(ind), Line(line) {}
+	};
+
+	vector<chrlen>	_pos;		// positions of data lines
+	vector<wigval>	_vals;		// values of data lines
+	vector<Decl>	_decls;		// declaration lines
+	string			_chrom;		// chromosome's name
+	WigWriter		_out;		// regulated output
+	ChromReg		_reg;
+	Thread*			_thread;
+
+	// Regulates stored records; thread procedure
+	static retThreadValType
+#ifdef OS_Windows
+		__stdcall
+#endif
+		Regulate(void* job);
+
+public:
+	// Creates new instance
+	//	@chrom: chromosome's name
+	//	@format: output format
+	//	@isMACS: true if wiggle is generated by MACS
+	//	@space: resolution
+	//	@fragSize: length of fragment aligned to resolution
+	inline ChromJob(const string& chrom, eFormat format, bool isMACS, BYTE space, chrlen fragSize)
+		: _chrom(chrom), _out(format), _reg(_out, isMACS, space, fragSize), _thread(NULL) {}
+
+	inline ~ChromJob() { WaitFor(); }
+
+	// Stores declaration line
+	inline void Declare(const char* line) { _decls.push_back(Decl(_pos.size(), line)); }
+
+	// Stores data line
+	inline void AddData(chrlen pos, wigval val) { _pos.push_back(pos); _vals.push_back(val); }
+
+	// Starts regulation in a separate thread
+	inline void Start() { _thread = new Thread(Regulate, this); }
+
+	// Gets the counters of chromosome; should not be used while regulation is running
+	inline ChromStats& Stats()	{ return _reg.Stats(); }
+
+	// Waits for the regulation to complete
+	void WaitFor();
+
+	// Waits for the regulation to complete and outputs regulated records
+	//	@out: output
+	//	@stats: statistics to add the chromosome's counters
+	void Print(WigWriter& out, WigStats& stats);
+};
+
+// 'ChromJobs' keeps the chromosomes regulated in parallel and outputs them in input order.
+class ChromJobs
+{
+private:
+	vector<ChromJob*> _jobs;	// unprinted jobs in input order; the last one is filling
+	WigWriter&	_out;			// output
+	WigStats&	_stats;			// statistics
+	const BYTE	_maxCnt;		// maximum number of simultaneously regulated jobs
+
+public:
+	// Creates new instance
+	//	@out: output
+	//	@stats: statistics
+	//	@threadCnt: maximum number of simultaneously regulated jobs
+	inline ChromJobs(WigWriter& out, WigStats& stats, BYTE threadCnt)
+		: _out(out), _stats(stats), _maxCnt(threadCnt) {}
+
+	~ChromJobs();
+
+	// Starts the filled job and adds new one.
+	// Outputs the oldest jobs if the limit of simultaneously regulated jobs is reached.
+	//	@chrom: chromosome's name
+	//	@isMACS: true if wiggle is generated by MACS
+	//	@space: resolution
+	//	@fragSize: length of fragment aligned to resolution
+	//	return: new job to fill
+	ChromJob* Add(const string& chrom, bool isMACS, BYTE space, chrlen fragSize);
+
+	// Starts the filled job and outputs all jobs in input order
+	void Flush();
+};
+#endif	// _MULTITHREAD
+
+// 'StrandReader' reads one strand's wiggle from PeakRanger chromosome by chromosome.
+// Values are read as absolute ones.
+// Chromosomes can be read in arbitrary order: skipped ones are kept in memory until they are required.
+class StrandReader
+{
+private:
+	// 'KeptChrom' keeps the records of chromosome read ahead
+	struct KeptChrom {
+		string	Name;
+		string	DeclLine;		// declaration line
+		vector<chrlen>	Pos;	// positions of data lines
+		vector<wigval>	Vals;	// values of data lines
+	};
+
+	TabFile	_file;
+	string	_defLine;			// definition line after track type key
+	string	_chrom;				// current chromosome's name
+	string	_declLine;			// current chromosome's declaration line
+	string	_nextChrom;			// name of the next chromosome in file, or empty if file is finished
+	string	_nextDecl;			// declaration line of the next chromosome in file
+	string	_sLine;				// current non-data line
+	list<KeptChrom>	_kept;		// chromosomes read ahead
+	list<KeptChrom>::iterator _replay;	// kept chromosome which is read now
+	size_t	_recInd;			// index of current record of kept chromosome
+	bool	_replaying;			// true if current chromosome is kept one
+	bool	_isData;			// true if current record belongs to current chromosome
+
+	// Applies declaration line
+	//	@line: declaration line
+	//	return: true if it declares the next chromosome
+	bool Declare(const char* line);
+
+	// Moves to the next chromosome in file
+	//	return: false if file is finished
+	bool StreamChrom();
+
+	// Reads the next chromosome in file into memory
+	void KeepChrom();
+
+	// Moves to kept chromosome
+	//	@it: kept chromosome
+	void StartReplay(list<KeptChrom>::iterator it);
+
+	// Releases kept chromosome if it is current
+	void EndReplay();
+
+public:
+	chrlen	Pos;				// current record's position
+	wigval	Val;				// current record's absolute value
+
+	// Opens wiggle and reads its definition
+	//	@fName: file name or "stdin"
+	//	@threadCnt: number of inflating threads
+	//	@prog: point to variable to set a program-source value
+	StrandReader(const char* fName, BYTE threadCnt, BYTE* prog);
+
+	// Gets definition line after track type key
+	inline const char* DefLine() const		{ return _defLine.c_str(); }
+
+	// Gets file
+	inline const TabFile& File() const		{ return _file; }
+
+	// Gets current chromosome's name
+	inline const string& Chrom() const		{ return _chrom; }
+
+	// Gets current chromosome's declaration line
+	inline const char* DeclLine() const		{ return _declLine.c_str(); }
+
+	// Returns true if current record belongs to current chromosome
+	inline bool IsData() const				{ return _isData; }
+
+	// Moves to the next data line of current chromosome
+	//	return: false if current chromosome is finished
+	bool NextData();
+
+	// Moves to the next chromosome: kept ones first, then the next one in file
+	//	return: false if there are no more chromosomes
+	bool NextChrom();
+
+	// Moves to the chromosome by name, keeping skipped ones in memory
+	//	@name: chromosome's name
+	//	return: false if there is no such chromosome
+	bool SeekChrom(const string& name);
+};
+
+class WigReg
+{
+private:
+	WigWriter	_out;
+	ULONG		_lineCnt;	// number of read lines or records
+	WigStats	_stats;
+	ULLONG		_chromPos;	// input position at the start of current chromosome
+	ULLONG		_chromTime;	// start time of current chromosome
 
 	// Replaces file name and correct description
 	void		CorrectDef(const char* line, const char* fName, BYTE space);
-	// Outputs declaration line
-	inline void	PrintDeclLine(chrlen span)		{ cout << _declLine << span << EOL; }
-	// Outputs data line
-	inline void	PrintLine(chrlen pos, int val)	{ cout << pos << TAB << val << EOL; _empty = false; }
-	// Outputs declaration and data line
-	inline void PrintRecord(chrlen pos, chrlen span, int val) {
-		PrintDeclLine(span);
-		PrintLine(pos, val);
-	}
+
+	// Adds the input length and time of current chromosome and starts the next one
+	//	@cName: current chromosome's name
+	//	@stats: current chromosome's counters
+	//	@pos: current input position, or 0 if it is unknown
+	void		EndChromInput(const string& cName, ChromStats& stats, ULLONG pos);
+
+	// Outputs the last record of chromosome and keeps its counters
+	//	@reg: regulator
+	//	@cName: chromosome's name
+	//	@pos: current input position, or 0 if it is unknown
+	void		CloseChrom(ChromReg& reg, const string& cName, ULLONG pos = 0);
+
+	// Regulates wiggle
+	//	@inFileName: input file name or "stdin"
+	//	@outFileName: output file name or "stdout"
+	//	@threadCnt: number of regulating threads
+	//	@buffers: owner of reused read buffers, or NULL
+	void		Regulate(const char* inFileName, const char* outFileName, BYTE threadCnt, TxtBuffers* buffers);
+
+	// Merges and regulates the wiggles of plus and minus strands from PeakRanger
+	//	@plusFileName: plus strand's file name or "stdin"
+	//	@minusFileName: minus strand's file name
+	//	@outFileName: output file name or "stdout"
+	//	@threadCnt: number of inflating threads
+	void		Merge(const char* plusFileName, const char* minusFileName, const char* outFileName, BYTE threadCnt);
+
+	// Outputs merged records of current chromosome
+	//	@reg: regulator
+	//	@plus: plus strand positioned on chromosome, or NULL if chromosome is absent in it
+	//	@minus: minus strand positioned on chromosome, or NULL if chromosome is absent in it
+	//	@sign: true if minus strand's values are subtracted, otherwise added
+	void		MergeChrom(ChromReg& reg, StrandReader* plus, StrandReader* minus, bool sign);
+
+	// Outputs records of binary track
+	//	@track: opened binary track
+	//	@outFileName: output file name or "stdout"
+	void		Print(TrackReader& track, const char* outFileName);
 public:
-	WigReg(const char* inFileName, const char* outFileName);
+	// Regulates wiggle or outputs binary track in given format
+	//	@inFileName: input file name or "stdin"
+	//	@outFileName: output file name or "stdout"
+	//	@threadCnt: number of regulating threads
+	//	@buffers: owner of reused read buffers, or NULL if buffers should be allocated
+	WigReg(const char* inFileName, const char* outFileName, BYTE threadCnt, TxtBuffers* buffers = NULL);
 
-	~WigReg() {
-		if( _initStream ) {
-			cout.rdbuf(_initStream);
-			if( _outFile.is_open() )	_outFile.close();
-		}
-	}
+	// Gets the number of read lines of wiggle or records of binary track
+	inline ULONG LineCount() const	{ return _lineCnt; }
+
+	// Gets the statistics of run
+	inline const WigStats& Stats() const	{ return _stats; }
+};
+
+// 'WigBatch' treats a set of files by the pool of workers in one process.
+// Each worker treats files one by one in single-thread mode and reuses its read buffers.
+class WigBatch
+{
+private:
+	// 'Job' keeps the names of treated files and the results of treatment
+	struct Job {
+		string	InName, OutName;
+		ULONG	LineCnt;		// number of read lines
+		LLONG	InSize, OutSize;
+		double	Time;			// wall-clock time of treatment in seconds
+		string	Error;			// error message, or empty if treatment is successful
+		WigStats Stats;			// statistics of treatment; if WigStats is enabled
+
+		inline Job(const string& inName, const string& outName) : InName(inName), OutName(outName),
+			LineCnt(0), InSize(0), OutSize(0), Time(0) {}
+	};
+
+	vector<Job>	_jobs;
+	size_t		_next;			// index of the next untreated job
+
+	// Adds job
+	//	@inName: input file name
+	//	@outName: output file name, relative one is placed in output directory;
+	//	if empty, input short name in output directory is used
+	//	@outDir: output directory ended by slash
+	void	AddJob(const string& inName, const string& outName, const string& outDir);
+
+	// Treats jobs until they run out
+	//	@buffers: read buffers of worker
+	void	Work(TxtBuffers& buffers);
+
+#ifdef _MULTITHREAD
+	// Treats jobs by separate worker; thread procedure
+	//	@batch: this instance
+	static retThreadValType
+#ifdef OS_Windows
+		__stdcall
+#endif
+		Worker(void* batch);
+#endif
+
+	// Prints summary table
+	void	PrintSummary() const;
+
+public:
+	// Treats files in parallel and prints summary table
+	//	@input: directory of wiggles, or list of input and optional output names separated by TAB
+	//	@outDir: output directory
+	//	@threadCnt: number of workers
+	WigBatch(const char* input, const char* outDir, BYTE threadCnt);
+
+	// Gets the number of failed files
+	size_t	ErrorCount() const;
+
+	// Saves the statistics of all files as JSON file
+	//	@fName: file name
+	void	SaveStats(const char* fName) const;
 };